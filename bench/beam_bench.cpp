@@ -0,0 +1,110 @@
+// Beam search with a preview of the coming pieces, played without
+// rendering at 1, 2, 4 and 8 workers sharing a transposition table, and
+// at 1 worker without one: boards reached per second, how many took their
+// score from the table, and how games go against the plain bot.
+//
+//   ./beam_bench [width] [preview] [pieces per game] [table MB]
+
+#include "BeamSearch.h"
+#include "JobSystem.h"
+#include "TranspositionTable.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+struct GameResult {
+    long long int pieces;
+    long long int lines;
+    long long int nodes;
+    long long int probes;
+    long long int hits;
+    long long int transpositions;
+    bool topped_out;
+};
+
+// The same seed gives the same pieces, so every worker count plays the
+// same games
+GameResult play(BeamSearch* search, int preview, int max_pieces, unsigned int seed) {
+    SHAPE_TYPE queue[BeamSearch::MAX_PIECES];
+    int count = preview + 1;
+    for (int i = 0; i < count; ++i) {
+        queue[i] = (SHAPE_TYPE)(rand_r(&seed) % TETRIS_TOTALSHAPE);
+    }
+    GameResult result = {0, 0, 0, 0, 0, 0, false};
+    Bitboard board = {};
+    for (; result.pieces < max_pieces; ++result.pieces) {
+        int best = search->choose(board, queue, count, PlacementFinder::spawn(queue[0]));
+        result.nodes += search->nodes();
+        result.probes += search->table_probes();
+        result.hits += search->table_hits();
+        result.transpositions += search->transpositions();
+        if (best < 0) {
+            result.topped_out = true;
+            break;
+        }
+        result.lines += Bot::place(&board, queue[0], search->finder().placement(best).position);
+        std::copy(queue + 1, queue + count, queue);
+        queue[count - 1] = (SHAPE_TYPE)(rand_r(&seed) % TETRIS_TOTALSHAPE);
+    }
+    return result;
+}
+
+}
+
+int main(int argc, char** argv) {
+    int width = argc > 1 ? atoi(argv[1]) : 32;
+    int preview = argc > 2 ? std::min(std::max(atoi(argv[2]), 0), BeamSearch::MAX_PIECES - 1) : 3;
+    int max_pieces = argc > 3 ? std::max(1, atoi(argv[3])) : 300;
+    int table_mb = argc > 4 ? std::max(1, atoi(argv[4])) : 16;
+    const int GAMES = 2;
+
+    TranspositionTable table(table_mb);
+    printf("table: %zu entries, %.1f MB\n", table.capacity(), table.memory_bytes() / 1048576.);
+
+    // The run without a table goes first and is the base of the speedups
+    const int workers[] = {1, 1, 2, 4, 8};
+    double base = 0.;
+    for (int w = 0; w < 5; ++w) {
+        JobSystem::init(workers[w]);
+        bool shared = w > 0;
+        table.clear();
+        BeamSearch* search = new BeamSearch(width, shared ? &table : NULL);
+        GameResult total = {0, 0, 0, 0, 0, 0, false};
+        auto start = std::chrono::steady_clock::now();
+        for (int game = 0; game < GAMES; ++game) {
+            GameResult result = play(search, preview, max_pieces, game + 1);
+            total.pieces += result.pieces;
+            total.lines += result.lines;
+            total.nodes += result.nodes;
+            total.probes += result.probes;
+            total.hits += result.hits;
+            total.transpositions += result.transpositions;
+            total.topped_out |= result.topped_out;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double rate = total.nodes / seconds;
+        if (w == 0) {
+            base = rate;
+            printf("width %d, %d preview, %lld pieces, %.1f lines per game%s, "
+                   "%.1f duplicate states per piece\n",
+                   search->width(), preview, total.pieces, (double)total.lines / GAMES,
+                   total.topped_out ? ", topped out" : "",
+                   (double)total.transpositions / std::max(total.pieces, 1LL));
+        }
+        printf("%d workers, %s: %.0f nodes/s, %.1f pieces/s, %.2fx", JobSystem::worker_count(),
+               shared ? "table" : "no table", rate, total.pieces / seconds, rate / base);
+        if (shared) {
+            printf(", %.1f%% of boards from the table, %.1f%% of probes hit",
+                   100. * total.hits / std::max(total.nodes, 1LL),
+                   100. * total.hits / std::max(total.probes, 1LL));
+        }
+        printf("\n");
+        delete search;
+        JobSystem::shutdown();
+    }
+    return 0;
+}
@@ -0,0 +1,45 @@
+// Games played by the bot without rendering: pieces placed per second and
+// how long games last.
+//
+//   ./bot_bench [games] [pieces per game]
+
+#include "Bot.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char** argv) {
+    int games = argc > 1 ? std::max(1, atoi(argv[1])) : 20;
+    int max_pieces = argc > 2 ? std::max(1, atoi(argv[2])) : 5000;
+
+    Bot* bot = new Bot();
+    long long int pieces = 0;
+    long long int lines = 0;
+    int topped_out = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int game = 0; game < games; ++game) {
+        unsigned int seed = game + 1;
+        Bitboard board = {};
+        int placed = 0;
+        for (; placed < max_pieces; ++placed) {
+            SHAPE_TYPE type = (SHAPE_TYPE)(rand_r(&seed) % TETRIS_TOTALSHAPE);
+            int best = bot->choose(board, type, PlacementFinder::spawn(type));
+            if (best < 0) {
+                ++topped_out;
+                break;
+            }
+            lines += Bot::place(&board, type, bot->finder().placement(best).position);
+        }
+        pieces += placed;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%lld pieces in %.3f s: %.0f pieces/s, %.2f us per piece\n", pieces, seconds,
+           pieces / seconds, 1e6 * seconds / pieces);
+    printf("%d games, %d topped out before %d pieces, %.1f lines per game\n", games,
+           topped_out, max_pieces, (double)lines / games);
+    delete bot;
+    return 0;
+}
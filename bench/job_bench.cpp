@@ -0,0 +1,124 @@
+// Scaling benchmark of the job system: the same parallel_for and fork-join
+// work with 1, 2, ... N workers, timed and checked against the 1 worker
+// result.
+//
+//   ./job_bench [max_workers] [repeats]
+
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+namespace {
+
+// Enough integer work per item that scheduling is not all that is measured
+uint64_t mix(uint64_t x) {
+    for (int i = 0; i < 64; ++i) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 29;
+    }
+    return x;
+}
+
+const int ITEMS = 1 << 20;
+const int GRAIN = 1024;
+
+uint64_t run_parallel_for() {
+    const int chunks = ITEMS / GRAIN;
+    static uint64_t partial[ITEMS / GRAIN];
+    JobSystem::parallel_for(0, ITEMS, GRAIN, [](int lo, int hi) {
+        uint64_t sum = 0;
+        for (int i = lo; i < hi; ++i) {
+            sum += mix(i);
+        }
+        partial[lo / GRAIN] = sum;
+    });
+    uint64_t total = 0;
+    for (int i = 0; i < chunks; ++i) {
+        total += partial[i];
+    }
+    return total;
+}
+
+// Below this the recursion runs serially
+const int FIB_CUTOFF = 18;
+
+uint64_t fib(int n) {
+    if (n < 2) {
+        return n;
+    }
+    if (n < FIB_CUTOFF) {
+        return fib(n - 1) + fib(n - 2);
+    }
+    uint64_t left = 0;
+    JobSystem::TaskGroup group;
+    group.run([&left, n] { left = fib(n - 1); });
+    uint64_t right = fib(n - 2);
+    group.wait();
+    return left + right;
+}
+
+uint64_t run_fork_join() {
+    return fib(32);
+}
+
+double time_ms(uint64_t (*work)(), int repeats, uint64_t* result) {
+    double best = 1e30;
+    for (int r = 0; r < repeats; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        *result = work();
+        double ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, ms);
+    }
+    return best;
+}
+
+}
+
+int main(int argc, char** argv) {
+    int cores = std::max(1, (int)std::thread::hardware_concurrency());
+    int max_workers = argc > 1 ? std::max(1, atoi(argv[1])) : cores;
+    int repeats = argc > 2 ? std::max(1, atoi(argv[2])) : 5;
+    printf("%d hardware threads, best of %d runs\n", cores, repeats);
+
+    struct Workload {
+        const char* name;
+        uint64_t (*work)();
+    } workloads[] = {
+        {"parallel_for", run_parallel_for},
+        {"fork_join", run_fork_join},
+    };
+
+    bool ok = true;
+    for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); ++w) {
+        printf("\n%-12s %7s %10s %8s %10s %10s %10s\n", workloads[w].name, "workers", "ms",
+               "speedup", "efficiency", "jobs", "stolen");
+        double base_ms = 0.;
+        uint64_t expected = 0;
+        for (int n = 1; n <= max_workers; ++n) {
+            JobSystem::init(n, n <= cores);
+            uint64_t result = 0;
+            double ms = time_ms(workloads[w].work, repeats, &result);
+            long long int jobs = JobSystem::executed_jobs();
+            long long int stolen = JobSystem::stolen_jobs();
+            JobSystem::shutdown();
+            if (n == 1) {
+                base_ms = ms;
+                expected = result;
+            } else if (result != expected) {
+                printf("%s with %d workers gave %llu instead of %llu\n", workloads[w].name, n,
+                       (unsigned long long)result, (unsigned long long)expected);
+                ok = false;
+            }
+            printf("%-12s %7d %10.2f %8.2f %9.0f%% %10lld %10lld\n", "", n, ms, base_ms / ms,
+                   100.0 * base_ms / ms / n, jobs, stolen);
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,61 @@
+// Monte Carlo tree search played without rendering at 1, 2, 4 and 8
+// workers: playouts per second, tree size and how the games go.
+//
+//   ./mcts_bench [playouts per move] [preview] [pieces per game]
+
+#include "MonteCarlo.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char** argv) {
+    int playouts = argc > 1 ? std::max(1, atoi(argv[1])) : 1000;
+    int preview = argc > 2 ? std::min(std::max(atoi(argv[2]), 0),
+                                      MonteCarloSearch::MAX_PIECES - 1) : 1;
+    int max_pieces = argc > 3 ? std::max(1, atoi(argv[3])) : 100;
+
+    const int workers[] = {1, 2, 4, 8};
+    double base = 0.;
+    for (int w = 0; w < 4; ++w) {
+        JobSystem::init(workers[w]);
+        MonteCarloSearch* search = new MonteCarloSearch();
+        unsigned int seed = 1;
+        SHAPE_TYPE queue[MonteCarloSearch::MAX_PIECES];
+        int count = preview + 1;
+        for (int i = 0; i < count; ++i) {
+            queue[i] = (SHAPE_TYPE)(rand_r(&seed) % TETRIS_TOTALSHAPE);
+        }
+        Bitboard board = {};
+        long long int lines = 0;
+        long long int nodes = 0;
+        int depth = 0;
+        int pieces = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (; pieces < max_pieces; ++pieces) {
+            int best = search->choose(board, queue, count, PlacementFinder::spawn(queue[0]),
+                                      playouts);
+            if (best < 0) {
+                break;
+            }
+            nodes += search->nodes_used();
+            depth = std::max(depth, search->max_depth());
+            lines += Bot::place(&board, queue[0], search->finder().placement(best).position);
+            std::copy(queue + 1, queue + count, queue);
+            queue[count - 1] = (SHAPE_TYPE)(rand_r(&seed) % TETRIS_TOTALSHAPE);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double rate = (double)playouts * pieces / seconds;
+        if (w == 0) {
+            base = rate;
+        }
+        printf("%d workers: %.0f playouts/s, %.2fx | %d pieces, %lld lines, %.0f nodes per move, "
+               "depth %d\n", JobSystem::worker_count(), rate, rate / base, pieces, lines,
+               (double)nodes / std::max(pieces, 1), depth);
+        delete search;
+        JobSystem::shutdown();
+    }
+    return 0;
+}
@@ -0,0 +1,253 @@
+// Throughput of PlacementFinder::find() on random boards: calls per
+// second, placements per call and the longest shortest path.
+//
+// The check mode instead compares the finder with a plain breadth-first
+// search that moves a TetrisShape the way the game does: the same lock
+// positions, the same shortest path lengths, and every path replayed on
+// the TetrisShape ends where the finder says. Exits with 1 on a mismatch.
+//
+//   ./placement_bench [calls]
+//   ./placement_bench check [boards]
+
+#include "Placements.h"
+#include "Helpers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// TetrisShape checks its moves against the game's board
+bool board_grid[TOTAL_ROWS][TOTAL_COLS];
+uint64_t board_hash = 0;
+uint32_t board_row_bits[TOTAL_ROWS];
+uint32_t board_col_bits[TOTAL_COLS];
+
+namespace {
+
+// Rough stacks: empty above a random height, then cells filled with a
+// random density so there are overhangs to slide and rotate under
+Bitboard random_board(unsigned int* seed) {
+    Bitboard board;
+    int top = 4 + rand_r(seed) % 12;
+    int density = 20 + rand_r(seed) % 60;
+    for (int r = 0; r < TOTAL_ROWS; ++r) {
+        board.rows[r] = 0;
+        for (int c = 0; r >= top && c < TOTAL_COLS; ++c) {
+            if (rand_r(seed) % 100 < density) {
+                board.rows[r] |= 1u << c;
+            }
+        }
+    }
+    return board;
+}
+
+const int STATES = PlacementFinder::MAX_ORIENTATIONS * TOTAL_ROWS * TOTAL_COLS;
+
+int state_index(const PiecePosition& position) {
+    return (position.orientation * TOTAL_ROWS + position.row) * TOTAL_COLS + position.col;
+}
+
+bool overlaps(const TetrisShape& shape) {
+    for (int i = 0; i < SQUARE_PER_SHAPE; ++i) {
+        int r = shape.cdnt[i].x;
+        int c = shape.cdnt[i].y;
+        if (r < 0 || r >= TOTAL_ROWS || c < 0 || c >= TOTAL_COLS || board_grid[r][c]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// One input as the game applies it; false when it would do nothing
+bool apply(TetrisShape* shape, PLACEMENT_INPUT input) {
+    switch (input) {
+        case PLACE_LEFT:
+        case PLACE_RIGHT: {
+            int dc = input == PLACE_LEFT ? -1 : 1;
+            if (shape->distance(0, dc) < 1) {
+                return false;
+            }
+            shape->shift(0, dc);
+            return true;
+        }
+        case PLACE_DOWN:
+        case PLACE_DROP: {
+            int free = shape->distance(1, 0);
+            if (free < 1) {
+                return false;
+            }
+            shape->shift(input == PLACE_DOWN ? 1 : free, 0);
+            return true;
+        }
+        case PLACE_ROTATE: {
+            if (!shape->can_morph()) {
+                return false;
+            }
+            TetrisShape rotated = *shape;
+            rotated.morph();
+            if (overlaps(rotated)) {
+                return false;
+            }
+            *shape = rotated;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool position_of(const TetrisShape& shape, PiecePosition* position) {
+    return PlacementFinder::locate(shape.stype, shape.cdnt, position);
+}
+
+// Shortest input counts from spawn to every state the game can reach,
+// -1 where it can not
+void reference_search(SHAPE_TYPE type, std::vector<int>* distance,
+                      std::vector<bool>* locks) {
+    distance->assign(STATES, -1);
+    locks->assign(STATES, false);
+    TetrisShape spawn(type);
+    if (overlaps(spawn)) {
+        return;
+    }
+    std::vector<TetrisShape> queue(1, spawn);
+    PiecePosition position;
+    position_of(spawn, &position);
+    (*distance)[state_index(position)] = 0;
+    for (size_t head = 0; head < queue.size(); ++head) {
+        TetrisShape shape = queue[head];
+        position_of(shape, &position);
+        int from = state_index(position);
+        (*locks)[from] = shape.distance(1, 0) == 0;
+        for (int input = PLACE_LEFT; input <= PLACE_DROP; ++input) {
+            TetrisShape next = shape;
+            if (!apply(&next, (PLACEMENT_INPUT)input) || !position_of(next, &position)) {
+                continue;
+            }
+            int to = state_index(position);
+            if ((*distance)[to] < 0) {
+                (*distance)[to] = (*distance)[from] + 1;
+                queue.push_back(next);
+            }
+        }
+    }
+}
+
+int check(int board_count) {
+    PlacementFinder* finder = new PlacementFinder();
+    PLACEMENT_INPUT inputs[PlacementFinder::MAX_INPUTS];
+    std::vector<int> distance;
+    std::vector<bool> locks;
+    std::vector<bool> found(STATES);
+    unsigned int seed = 1;
+    long long int placements = 0;
+    int failures = 0;
+    for (int b = 0; b < board_count && failures < 10; ++b) {
+        Bitboard board = random_board(&seed);
+        for (int c = 0; c < TOTAL_COLS; ++c) {
+            board_col_bits[c] = 0;
+        }
+        for (int r = 0; r < TOTAL_ROWS; ++r) {
+            board_row_bits[r] = board.rows[r];
+            for (int c = 0; c < TOTAL_COLS; ++c) {
+                board_grid[r][c] = (board.rows[r] >> c) & 1;
+                board_col_bits[c] |= (uint32_t)board_grid[r][c] << r;
+            }
+        }
+        SHAPE_TYPE type = (SHAPE_TYPE)(b % TETRIS_TOTALSHAPE);
+        reference_search(type, &distance, &locks);
+        int count = finder->find(board, type, PlacementFinder::spawn(type));
+        placements += count;
+        found.assign(STATES, false);
+
+        for (int p = 0; p < count && failures < 10; ++p) {
+            const Placement& placement = finder->placement(p);
+            int index = state_index(placement.position);
+            found[index] = true;
+            if (!locks[index] || distance[index] != placement.inputs) {
+                printf("board %d type %d: placement %d/%d/%d, %d inputs, game %s in %d\n", b,
+                       type, placement.position.orientation, placement.position.row,
+                       placement.position.col, placement.inputs,
+                       locks[index] ? "locks" : "does not lock", distance[index]);
+                ++failures;
+                continue;
+            }
+            int length = finder->path(p, inputs, PlacementFinder::MAX_INPUTS);
+            TetrisShape shape(type);
+            bool replayed = length == placement.inputs;
+            for (int i = 0; replayed && i < length; ++i) {
+                replayed = apply(&shape, inputs[i]);
+            }
+            PiecePosition end;
+            if (!replayed || !position_of(shape, &end) || state_index(end) != index) {
+                printf("board %d type %d: path to placement %d does not replay\n", b, type, p);
+                ++failures;
+            }
+        }
+        for (int i = 0; i < STATES && failures < 10; ++i) {
+            if (locks[i] && distance[i] <= PlacementFinder::MAX_INPUTS && !found[i]) {
+                printf("board %d type %d: state %d locks in %d inputs, not found\n", b, type,
+                       i, distance[i]);
+                ++failures;
+            }
+        }
+    }
+    delete finder;
+    if (failures > 0) {
+        printf("check failed\n");
+        return 1;
+    }
+    printf("%d boards, %lld placements: lock positions, path lengths and paths match the game\n",
+           board_count, placements);
+    return 0;
+}
+
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "check") == 0) {
+        return check(argc > 2 ? std::max(1, atoi(argv[2])) : 3000);
+    }
+    long long int calls = argc > 1 ? std::max(1, atoi(argv[1])) : 200000;
+    const int BOARDS = 1024;
+    unsigned int seed = 1;
+    std::vector<Bitboard> boards;
+    for (int i = 0; i < BOARDS; ++i) {
+        boards.push_back(random_board(&seed));
+    }
+
+    PlacementFinder* finder = new PlacementFinder();
+    PLACEMENT_INPUT inputs[PlacementFinder::MAX_INPUTS];
+    long long int placements = 0;
+    int longest = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (long long int i = 0; i < calls; ++i) {
+        SHAPE_TYPE type = (SHAPE_TYPE)(i % TETRIS_TOTALSHAPE);
+        int count = finder->find(boards[i % BOARDS], type, PlacementFinder::spawn(type));
+        placements += count;
+        for (int p = 0; p < count; ++p) {
+            longest = std::max(longest, finder->placement(p).inputs);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Paths are rebuilt on demand, time them separately
+    start = std::chrono::steady_clock::now();
+    long long int path_inputs = 0;
+    for (int p = 0; p < finder->count(); ++p) {
+        path_inputs += finder->path(p, inputs, PlacementFinder::MAX_INPUTS);
+    }
+    double path_us = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - start).count();
+
+    printf("%lld calls in %.3f s: %.0f calls/s, %.2f us per call\n", calls, seconds,
+           calls / seconds, 1e6 * seconds / calls);
+    printf("%.1f placements per call, longest shortest path %d inputs\n",
+           (double)placements / calls, longest);
+    printf("%d paths (%lld inputs) of the last call rebuilt in %.2f us\n", finder->count(),
+           path_inputs, path_us);
+    delete finder;
+    return 0;
+}
@@ -0,0 +1,122 @@
+# Generates a GL loader that resolves only the entry points the game calls.
+#
+# generate_gl_loader(<output dir> <glext.h> <sources...>) scans the sources for
+# gl*( calls and writes gl_loader.h and gl_loader.cpp into the output dir.
+# Functions with a PFN typedef in glext.h are loaded at runtime through the
+# getter passed to gl_loader_init(); the others are GL 1.1 and come straight
+# from the system GL library, as with GLEW.
+
+function(write_if_changed PATH CONTENT)
+  set(old "")
+  if(EXISTS "${PATH}")
+    file(READ "${PATH}" old)
+  endif()
+  if(NOT old STREQUAL CONTENT)
+    file(WRITE "${PATH}" "${CONTENT}")
+  endif()
+endfunction()
+
+function(generate_gl_loader OUT_DIR GLEXT_HEADER)
+  file(READ "${GLEXT_HEADER}" glext)
+
+  # glGetStringi is needed by gl_loader_has_extension itself
+  set(names glGetStringi)
+  foreach(src ${ARGN})
+    file(READ "${src}" content)
+    string(REGEX MATCHALL "gl[A-Z][A-Za-z0-9_]*[ \t]*\\(" calls "${content}")
+    foreach(call ${calls})
+      string(REGEX REPLACE "[ \t]*\\($" "" name "${call}")
+      list(APPEND names ${name})
+    endforeach()
+  endforeach()
+  list(REMOVE_DUPLICATES names)
+  list(SORT names)
+
+  set(declarations "")
+  set(defines "")
+  set(definitions "")
+  set(loads "")
+  set(count 0)
+  foreach(name ${names})
+    string(TOUPPER "${name}" upper)
+    set(pfn "PFN${upper}PROC")
+    string(FIND "${glext}" "${pfn})" found)
+    if(NOT found EQUAL -1)
+      set(declarations "${declarations}extern ${pfn} gl_loader_${name};\n")
+      set(defines "${defines}#define ${name} gl_loader_${name}\n")
+      set(definitions "${definitions}${pfn} gl_loader_${name} = NULL;\n")
+      set(loads "${loads}    gl_loader_${name} = (${pfn})get(\"${name}\");\n    missing += gl_loader_${name} == NULL;\n")
+      math(EXPR count "${count} + 1")
+    endif()
+  endforeach()
+
+  set(header "// Generated by cmake/GenerateGLLoader.cmake, do not edit
+#ifndef GL_LOADER_H
+#define GL_LOADER_H
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+typedef void (*gl_loader_proc)(void);
+typedef gl_loader_proc (*gl_loader_getter)(const char* name);
+
+// Number of entry points resolved by gl_loader_init
+#define GL_LOADER_FUNCTIONS ${count}
+
+// Resolves every entry point with get, returns how many were not found
+int gl_loader_init(gl_loader_getter get);
+
+// Queries on the current context, valid after gl_loader_init
+bool gl_loader_version_at_least(int major, int minor);
+bool gl_loader_has_extension(const char* name);
+
+${declarations}
+${defines}
+#endif
+")
+
+  set(source "// Generated by cmake/GenerateGLLoader.cmake, do not edit
+#include \"gl_loader.h\"
+
+#include <cstdio>
+#include <cstring>
+
+${definitions}
+int gl_loader_init(gl_loader_getter get) {
+    int missing = 0;
+${loads}    return missing;
+}
+
+bool gl_loader_version_at_least(int major, int minor) {
+    const char* version = (const char*)glGetString(GL_VERSION);
+    int ctx_major = 0;
+    int ctx_minor = 0;
+    if (version == NULL || sscanf(version, \"%d.%d\", &ctx_major, &ctx_minor) != 2) {
+        return false;
+    }
+    return ctx_major > major || (ctx_major == major && ctx_minor >= minor);
+}
+
+bool gl_loader_has_extension(const char* name) {
+    if (gl_loader_glGetStringi == NULL) {
+        return false;
+    }
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        const char* ext = (const char*)gl_loader_glGetStringi(GL_EXTENSIONS, i);
+        if (ext != NULL && strcmp(ext, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+")
+
+  # Only touch the files when the function list changed, so editing a
+  # source does not rebuild everything that includes the header
+  write_if_changed("${OUT_DIR}/gl_loader.h" "${header}")
+  write_if_changed("${OUT_DIR}/gl_loader.cpp" "${source}")
+
+  message(STATUS "GL loader: ${count} entry points")
+endfunction()
@@ -52,6 +52,7 @@ extern "C" {
  *  * `GLFW_EXPOSE_NATIVE_WIN32`
  *  * `GLFW_EXPOSE_NATIVE_COCOA`
  *  * `GLFW_EXPOSE_NATIVE_X11`
+ *  * `GLFW_EXPOSE_NATIVE_NULL`
  *
  *  The available context API macros are:
  *  * `GLFW_EXPOSE_NATIVE_WGL`
@@ -86,6 +87,8 @@ extern "C" {
 #elif defined(GLFW_EXPOSE_NATIVE_X11)
  #include <X11/Xlib.h>
  #include <X11/extensions/Xrandr.h>
+#elif defined(GLFW_EXPOSE_NATIVE_NULL)
+ /* The null platform has no native window system headers */
 #else
  #error "No window API selected"
 #endif
@@ -284,6 +287,104 @@ GLFWAPI RROutput glfwGetX11Monitor(GLFWmonitor* monitor);
 GLFWAPI Window glfwGetX11Window(GLFWwindow* window);
 #endif
 
+#if defined(GLFW_EXPOSE_NATIVE_NULL)
+/*! @brief Queues a key event for the specified window.
+ *
+ *  The event is delivered to the key callback, and reflected by @ref
+ *  glfwGetKey, the next time events are processed by @ref glfwPollEvents or
+ *  @ref glfwWaitEvents, exactly as if it had come from a keyboard.
+ *
+ *  @par Thread Safety
+ *  This function may be called from any thread.
+ *
+ *  @ingroup native
+ */
+GLFWAPI void glfwNullInjectKey(GLFWwindow* window, int key, int scancode, int action, int mods);
+
+/*! @brief Queues a Unicode character event for the specified window.
+ *
+ *  @par Thread Safety
+ *  This function may be called from any thread.
+ *
+ *  @ingroup native
+ */
+GLFWAPI void glfwNullInjectChar(GLFWwindow* window, unsigned int codepoint, int mods);
+
+/*! @brief Queues a mouse button event for the specified window.
+ *
+ *  @par Thread Safety
+ *  This function may be called from any thread.
+ *
+ *  @ingroup native
+ */
+GLFWAPI void glfwNullInjectMouseButton(GLFWwindow* window, int button, int action, int mods);
+
+/*! @brief Queues a cursor motion event for the specified window.
+ *
+ *  @par Thread Safety
+ *  This function may be called from any thread.
+ *
+ *  @ingroup native
+ */
+GLFWAPI void glfwNullInjectCursorPos(GLFWwindow* window, double xpos, double ypos);
+
+/*! @brief Queues a scroll event for the specified window.
+ *
+ *  @par Thread Safety
+ *  This function may be called from any thread.
+ *
+ *  @ingroup native
+ */
+GLFWAPI void glfwNullInjectScroll(GLFWwindow* window, double xoffset, double yoffset);
+
+/*! @brief Queues a focus gain or loss for the specified window.
+ *
+ *  @par Thread Safety
+ *  This function may be called from any thread.
+ *
+ *  @ingroup native
+ */
+GLFWAPI void glfwNullInjectFocus(GLFWwindow* window, int focused);
+
+/*! @brief Queues an iconification or restoration of the specified window.
+ *
+ *  @par Thread Safety
+ *  This function may be called from any thread.
+ *
+ *  @ingroup native
+ */
+GLFWAPI void glfwNullInjectIconify(GLFWwindow* window, int iconified);
+
+/*! @brief Queues a resize of the specified window and its framebuffer.
+ *
+ *  The rendering surface keeps the size it was created with.
+ *
+ *  @par Thread Safety
+ *  This function may be called from any thread.
+ *
+ *  @ingroup native
+ */
+GLFWAPI void glfwNullInjectResize(GLFWwindow* window, int width, int height);
+
+/*! @brief Queues a close request for the specified window.
+ *
+ *  @par Thread Safety
+ *  This function may be called from any thread.
+ *
+ *  @ingroup native
+ */
+GLFWAPI void glfwNullInjectClose(GLFWwindow* window);
+
+/*! @brief Returns the number of injected events not yet processed.
+ *
+ *  @par Thread Safety
+ *  This function may be called from any thread.
+ *
+ *  @ingroup native
+ */
+GLFWAPI int glfwNullGetPendingEventCount(void);
+#endif
+
 #if defined(GLFW_EXPOSE_NATIVE_GLX)
 /*! @brief Returns the `GLXContext` of the specified window.
  *
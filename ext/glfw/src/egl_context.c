@@ -122,9 +122,15 @@ static GLboolean chooseFBConfigs(const _GLFWctxconfig* ctxconfig,
         if (!(getConfigAttrib(n, EGL_COLOR_BUFFER_TYPE) & EGL_RGB_BUFFER))
             continue;
 
+#if defined(_GLFW_NULL)
+        // Only consider pbuffer EGLConfigs, as there are no native windows
+        if (!(getConfigAttrib(n, EGL_SURFACE_TYPE) & EGL_PBUFFER_BIT))
+            continue;
+#else
         // Only consider window EGLConfigs
         if (!(getConfigAttrib(n, EGL_SURFACE_TYPE) & EGL_WINDOW_BIT))
             continue;
+#endif // _GLFW_NULL
 
         if (ctxconfig->api == GLFW_OPENGL_ES_API)
         {
@@ -231,6 +237,8 @@ int _glfwInitContextAPI(void)
         _glfw_dlsym(_glfw.egl.handle, "eglDestroyContext");
     _glfw.egl.CreateWindowSurface =
         _glfw_dlsym(_glfw.egl.handle, "eglCreateWindowSurface");
+    _glfw.egl.CreatePbufferSurface =
+        _glfw_dlsym(_glfw.egl.handle, "eglCreatePbufferSurface");
     _glfw.egl.MakeCurrent =
         _glfw_dlsym(_glfw.egl.handle, "eglMakeCurrent");
     _glfw.egl.SwapBuffers =
@@ -242,6 +250,31 @@ int _glfwInitContextAPI(void)
     _glfw.egl.GetProcAddress =
         _glfw_dlsym(_glfw.egl.handle, "eglGetProcAddress");
 
+#if defined(_GLFW_NULL)
+    // Prefer the Mesa surfaceless platform, which needs no display server
+    _glfw.egl.display = EGL_NO_DISPLAY;
+    {
+        const char* extensions = _glfw_eglQueryString(EGL_NO_DISPLAY,
+                                                      EGL_EXTENSIONS);
+        if (extensions &&
+            _glfwStringInExtensionString("EGL_MESA_platform_surfaceless",
+                                         extensions))
+        {
+            PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+                (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+                _glfw_eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+            if (getPlatformDisplay)
+            {
+                _glfw.egl.display =
+                    getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                       EGL_DEFAULT_DISPLAY, NULL);
+            }
+        }
+    }
+
+    if (_glfw.egl.display == EGL_NO_DISPLAY)
+#endif // _GLFW_NULL
     _glfw.egl.display =
         _glfw_eglGetDisplay((EGLNativeDisplayType)_GLFW_EGL_NATIVE_DISPLAY);
     if (_glfw.egl.display == EGL_NO_DISPLAY)
@@ -586,11 +619,25 @@ void _glfwPlatformMakeContextCurrent(_GLFWwindow* window)
     {
         if (window->egl.surface == EGL_NO_SURFACE)
         {
+#if defined(_GLFW_NULL)
+            const EGLint attribs[] =
+            {
+                EGL_WIDTH, window->null.width,
+                EGL_HEIGHT, window->null.height,
+                EGL_NONE
+            };
+
+            window->egl.surface =
+                _glfw_eglCreatePbufferSurface(_glfw.egl.display,
+                                              window->egl.config,
+                                              attribs);
+#else
             window->egl.surface =
                 _glfw_eglCreateWindowSurface(_glfw.egl.display,
                                              window->egl.config,
                                              (EGLNativeWindowType)_GLFW_EGL_NATIVE_WINDOW,
                                              NULL);
+#endif // _GLFW_NULL
             if (window->egl.surface == EGL_NO_SURFACE)
             {
                 _glfwInputError(GLFW_PLATFORM_ERROR,
@@ -46,6 +46,13 @@
 // extensions and not all operating systems come with an up-to-date version
 #include "../deps/EGL/eglext.h"
 
+#if defined(_GLFW_NULL)
+ // These are newer than our copy of eglext.h
+ #ifndef EGL_PLATFORM_SURFACELESS_MESA
+  #define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+ #endif
+#endif
+
 // EGL function pointer typedefs
 typedef EGLBoolean (EGLAPIENTRY * PFNEGLGETCONFIGATTRIBPROC)(EGLDisplay,EGLConfig,EGLint,EGLint*);
 typedef EGLBoolean (EGLAPIENTRY * PFNEGLGETCONFIGSPROC)(EGLDisplay,EGLConfig*,EGLint,EGLint*);
@@ -58,6 +65,8 @@ typedef EGLContext (EGLAPIENTRY * PFNEGLCREATECONTEXTPROC)(EGLDisplay,EGLConfig,
 typedef EGLBoolean (EGLAPIENTRY * PFNEGLDESTROYSURFACEPROC)(EGLDisplay,EGLSurface);
 typedef EGLBoolean (EGLAPIENTRY * PFNEGLDESTROYCONTEXTPROC)(EGLDisplay,EGLContext);
 typedef EGLSurface (EGLAPIENTRY * PFNEGLCREATEWINDOWSURFACEPROC)(EGLDisplay,EGLConfig,EGLNativeWindowType,const EGLint*);
+typedef EGLSurface (EGLAPIENTRY * PFNEGLCREATEPBUFFERSURFACEPROC)(EGLDisplay,EGLConfig,const EGLint*);
+typedef EGLDisplay (EGLAPIENTRY * PFNEGLGETPLATFORMDISPLAYEXTPROC)(EGLenum,void*,const EGLint*);
 typedef EGLBoolean (EGLAPIENTRY * PFNEGLMAKECURRENTPROC)(EGLDisplay,EGLSurface,EGLSurface,EGLContext);
 typedef EGLBoolean (EGLAPIENTRY * PFNEGLSWAPBUFFERSPROC)(EGLDisplay,EGLSurface);
 typedef EGLBoolean (EGLAPIENTRY * PFNEGLSWAPINTERVALPROC)(EGLDisplay,EGLint);
@@ -74,6 +83,7 @@ typedef GLFWglproc (EGLAPIENTRY * PFNEGLGETPROCADDRESSPROC)(const char*);
 #define _glfw_eglDestroySurface _glfw.egl.DestroySurface
 #define _glfw_eglDestroyContext _glfw.egl.DestroyContext
 #define _glfw_eglCreateWindowSurface _glfw.egl.CreateWindowSurface
+#define _glfw_eglCreatePbufferSurface _glfw.egl.CreatePbufferSurface
 #define _glfw_eglMakeCurrent _glfw.egl.MakeCurrent
 #define _glfw_eglSwapBuffers _glfw.egl.SwapBuffers
 #define _glfw_eglSwapInterval _glfw.egl.SwapInterval
@@ -124,6 +134,7 @@ typedef struct _GLFWlibraryEGL
     PFNEGLDESTROYSURFACEPROC        DestroySurface;
     PFNEGLDESTROYCONTEXTPROC        DestroyContext;
     PFNEGLCREATEWINDOWSURFACEPROC   CreateWindowSurface;
+    PFNEGLCREATEPBUFFERSURFACEPROC  CreatePbufferSurface;
     PFNEGLMAKECURRENTPROC           MakeCurrent;
     PFNEGLSWAPBUFFERSPROC           SwapBuffers;
     PFNEGLSWAPINTERVALPROC          SwapInterval;
@@ -91,6 +91,8 @@ typedef struct _GLFWcursor      _GLFWcursor;
  #include "wl_platform.h"
 #elif defined(_GLFW_MIR)
  #include "mir_platform.h"
+#elif defined(_GLFW_NULL)
+ #include "null_platform.h"
 #else
  #error "No supported window creation API selected"
 #endif
@@ -595,6 +597,11 @@ void _glfwPlatformPollEvents(void);
  */
 void _glfwPlatformWaitEvents(void);
 
+/*! @copydoc glfwWaitEventsTimeout
+ *  @ingroup platform
+ */
+void _glfwPlatformWaitEventsTimeout(double timeout);
+
 /*! @copydoc glfwPostEmptyEvent
  *  @ingroup platform
  */
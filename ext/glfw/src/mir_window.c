@@ -29,6 +29,7 @@
 #include <linux/input.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 
 typedef struct EventNode
@@ -637,6 +638,28 @@ void _glfwPlatformWaitEvents(void)
     _glfwPlatformPollEvents();
 }
 
+void _glfwPlatformWaitEventsTimeout(double timeout)
+{
+    struct timespec deadline;
+    time_t seconds;
+
+    // pthread_cond_timedwait takes an absolute CLOCK_REALTIME deadline
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    timeout += deadline.tv_nsec / 1e9;
+    seconds = (time_t) timeout;
+    deadline.tv_sec += seconds;
+    deadline.tv_nsec = (long) ((timeout - (double) seconds) * 1e9);
+
+    pthread_mutex_lock(&_glfw.mir.event_mutex);
+
+    if (emptyEventQueue(_glfw.mir.event_queue))
+        pthread_cond_timedwait(&_glfw.mir.event_cond, &_glfw.mir.event_mutex, &deadline);
+
+    pthread_mutex_unlock(&_glfw.mir.event_mutex);
+
+    _glfwPlatformPollEvents();
+}
+
 void _glfwPlatformPostEmptyEvent(void)
 {
 }
@@ -0,0 +1,117 @@
+//========================================================================
+// GLFW 3.1 Null - www.glfw.org
+//------------------------------------------------------------------------
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would
+//    be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such, and must not
+//    be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source
+//    distribution.
+//
+//========================================================================
+
+
+#include "internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+//////////////////////////////////////////////////////////////////////////
+//////                       GLFW internal API                      //////
+//////////////////////////////////////////////////////////////////////////
+
+int _glfwPlatformInit(void)
+{
+    int error;
+
+    error = pthread_mutex_init(&_glfw.null.eventMutex, NULL);
+    if (error)
+    {
+        _glfwInputError(GLFW_PLATFORM_ERROR,
+                        "Null: Failed to create event mutex: %s",
+                        strerror(error));
+        return GL_FALSE;
+    }
+
+    error = pthread_cond_init(&_glfw.null.eventCond, NULL);
+    if (error)
+    {
+        _glfwInputError(GLFW_PLATFORM_ERROR,
+                        "Null: Failed to create event condition: %s",
+                        strerror(error));
+        return GL_FALSE;
+    }
+
+    if (!_glfwInitContextAPI())
+        return GL_FALSE;
+
+    _glfwInitTimer();
+
+    return GL_TRUE;
+}
+
+void _glfwPlatformTerminate(void)
+{
+    _glfwTerminateContextAPI();
+
+    free(_glfw.null.clipboardString);
+    _glfw.null.clipboardString = NULL;
+
+    pthread_cond_destroy(&_glfw.null.eventCond);
+    pthread_mutex_destroy(&_glfw.null.eventMutex);
+}
+
+const char* _glfwPlatformGetVersionString(void)
+{
+    return _GLFW_VERSION_NUMBER " null EGL"
+#if defined(_POSIX_TIMERS) && defined(_POSIX_MONOTONIC_CLOCK)
+        " clock_gettime"
+#else
+        " gettimeofday"
+#endif
+#if defined(_GLFW_BUILD_DLL)
+        " shared"
+#endif
+        ;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//////                       GLFW platform API                      //////
+//////////////////////////////////////////////////////////////////////////
+
+int _glfwPlatformJoystickPresent(int joy)
+{
+    return GL_FALSE;
+}
+
+const float* _glfwPlatformGetJoystickAxes(int joy, int* count)
+{
+    *count = 0;
+    return NULL;
+}
+
+const unsigned char* _glfwPlatformGetJoystickButtons(int joy, int* count)
+{
+    *count = 0;
+    return NULL;
+}
+
+const char* _glfwPlatformGetJoystickName(int joy)
+{
+    return NULL;
+}
+
@@ -0,0 +1,103 @@
+//========================================================================
+// GLFW 3.1 Null - www.glfw.org
+//------------------------------------------------------------------------
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would
+//    be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such, and must not
+//    be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source
+//    distribution.
+//
+//========================================================================
+
+
+#include "internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// The single virtual monitor reported by the null backend
+//
+#define _GLFW_NULL_MONITOR_WIDTH   1920
+#define _GLFW_NULL_MONITOR_HEIGHT  1080
+#define _GLFW_NULL_MONITOR_REFRESH 60
+
+
+//////////////////////////////////////////////////////////////////////////
+//////                       GLFW platform API                      //////
+//////////////////////////////////////////////////////////////////////////
+
+_GLFWmonitor** _glfwPlatformGetMonitors(int* count)
+{
+    _GLFWmonitor** monitors = calloc(1, sizeof(_GLFWmonitor*));
+
+    // Assume a 24 inch 16:9 panel for the physical size
+    monitors[0] = _glfwAllocMonitor("Null", 531, 299);
+
+    *count = 1;
+    return monitors;
+}
+
+GLboolean _glfwPlatformIsSameMonitor(_GLFWmonitor* first, _GLFWmonitor* second)
+{
+    return first == second || strcmp(first->name, second->name) == 0;
+}
+
+void _glfwPlatformGetMonitorPos(_GLFWmonitor* monitor, int* xpos, int* ypos)
+{
+    if (xpos)
+        *xpos = 0;
+    if (ypos)
+        *ypos = 0;
+}
+
+GLFWvidmode* _glfwPlatformGetVideoModes(_GLFWmonitor* monitor, int* found)
+{
+    GLFWvidmode* mode = calloc(1, sizeof(GLFWvidmode));
+    _glfwPlatformGetVideoMode(monitor, mode);
+    *found = 1;
+    return mode;
+}
+
+void _glfwPlatformGetVideoMode(_GLFWmonitor* monitor, GLFWvidmode* mode)
+{
+    mode->width = _GLFW_NULL_MONITOR_WIDTH;
+    mode->height = _GLFW_NULL_MONITOR_HEIGHT;
+    mode->redBits = 8;
+    mode->greenBits = 8;
+    mode->blueBits = 8;
+    mode->refreshRate = _GLFW_NULL_MONITOR_REFRESH;
+}
+
+void _glfwPlatformGetGammaRamp(_GLFWmonitor* monitor, GLFWgammaramp* ramp)
+{
+    unsigned int i;
+
+    // There is no display hardware, so always report a linear ramp
+    _glfwAllocGammaArrays(ramp, 256);
+
+    for (i = 0;  i < ramp->size;  i++)
+    {
+        const unsigned short value = (unsigned short) (i * 257);
+        ramp->red[i] = value;
+        ramp->green[i] = value;
+        ramp->blue[i] = value;
+    }
+}
+
+void _glfwPlatformSetGammaRamp(_GLFWmonitor* monitor, const GLFWgammaramp* ramp)
+{
+}
+
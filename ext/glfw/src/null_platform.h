@@ -0,0 +1,146 @@
+//========================================================================
+// GLFW 3.1 Null - www.glfw.org
+//------------------------------------------------------------------------
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would
+//    be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such, and must not
+//    be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source
+//    distribution.
+//
+//========================================================================
+
+
+#ifndef _glfw3_null_platform_h_
+#define _glfw3_null_platform_h_
+
+#include <pthread.h>
+
+#include "posix_tls.h"
+#include "posix_time.h"
+
+#if defined(_GLFW_EGL)
+ #include "egl_context.h"
+#else
+ #error "The null backend depends on EGL platform support"
+#endif
+
+// The null backend has no native window; EGL renders into a pbuffer instead
+#define _GLFW_EGL_NATIVE_WINDOW  NULL
+#define _GLFW_EGL_NATIVE_DISPLAY EGL_DEFAULT_DISPLAY
+
+#define _GLFW_PLATFORM_WINDOW_STATE           _GLFWwindowNull   null
+#define _GLFW_PLATFORM_MONITOR_STATE          _GLFWmonitorNull  null
+#define _GLFW_PLATFORM_LIBRARY_WINDOW_STATE   _GLFWlibraryNull  null
+#define _GLFW_PLATFORM_LIBRARY_JOYSTICK_STATE _GLFWjoystickNull null_js
+#define _GLFW_PLATFORM_CURSOR_STATE           _GLFWcursorNull   null
+
+#define _GLFW_NULL_EVENT_QUEUE_SIZE 1024
+
+
+// Null-specific event types
+//
+typedef enum _GLFWeventTypeNull
+{
+    _GLFW_NULL_EVENT_KEY,
+    _GLFW_NULL_EVENT_CHAR,
+    _GLFW_NULL_EVENT_MOUSE_BUTTON,
+    _GLFW_NULL_EVENT_CURSOR_POS,
+    _GLFW_NULL_EVENT_SCROLL,
+    _GLFW_NULL_EVENT_FOCUS,
+    _GLFW_NULL_EVENT_ICONIFY,
+    _GLFW_NULL_EVENT_SIZE,
+    _GLFW_NULL_EVENT_CLOSE,
+    _GLFW_NULL_EVENT_EMPTY
+
+} _GLFWeventTypeNull;
+
+// Null-specific queued event
+//
+typedef struct _GLFWeventNull
+{
+    _GLFWeventTypeNull  type;
+    _GLFWwindow*        window;
+    int                 a, b, c, d;
+    double              x, y;
+
+} _GLFWeventNull;
+
+// Null-specific per-window data
+//
+typedef struct _GLFWwindowNull
+{
+    int         xpos;
+    int         ypos;
+    int         width;
+    int         height;
+    char*       title;
+    GLboolean   visible;
+    GLboolean   iconified;
+    GLboolean   focused;
+    double      cursorPosX;
+    double      cursorPosY;
+
+} _GLFWwindowNull;
+
+
+// Null-specific per-monitor data
+//
+typedef struct _GLFWmonitorNull
+{
+    int         unused;
+
+} _GLFWmonitorNull;
+
+
+// Null-specific global data
+//
+typedef struct _GLFWlibraryNull
+{
+    char*           clipboardString;
+    _GLFWwindow*    focusedWindow;
+
+    // Events injected by the application, dispatched by glfwPollEvents
+    _GLFWeventNull  events[_GLFW_NULL_EVENT_QUEUE_SIZE];
+    int             eventHead;
+    int             eventCount;
+
+    pthread_mutex_t eventMutex;
+    pthread_cond_t  eventCond;
+
+} _GLFWlibraryNull;
+
+
+// Null-specific joystick data
+//
+typedef struct _GLFWjoystickNull
+{
+    int         unused;
+
+} _GLFWjoystickNull;
+
+
+// Null-specific per-cursor data
+//
+typedef struct _GLFWcursorNull
+{
+    int         unused;
+
+} _GLFWcursorNull;
+
+
+GLboolean _glfwEnqueueEventNull(const _GLFWeventNull* event);
+
+#endif // _glfw3_null_platform_h_
@@ -0,0 +1,576 @@
+//========================================================================
+// GLFW 3.1 Null - www.glfw.org
+//------------------------------------------------------------------------
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would
+//    be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such, and must not
+//    be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source
+//    distribution.
+//
+//========================================================================
+
+
+#include "internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+
+// Removes the oldest event from the queue
+// The event mutex must be held by the caller
+//
+static GLboolean dequeueEvent(_GLFWeventNull* event)
+{
+    if (_glfw.null.eventCount == 0)
+        return GL_FALSE;
+
+    *event = _glfw.null.events[_glfw.null.eventHead];
+    _glfw.null.eventHead =
+        (_glfw.null.eventHead + 1) % _GLFW_NULL_EVENT_QUEUE_SIZE;
+    _glfw.null.eventCount--;
+
+    return GL_TRUE;
+}
+
+// Returns whether the specified window still exists
+//
+static GLboolean isValidWindow(_GLFWwindow* window)
+{
+    _GLFWwindow* entry;
+
+    for (entry = _glfw.windowListHead;  entry;  entry = entry->next)
+    {
+        if (entry == window)
+            return GL_TRUE;
+    }
+
+    return GL_FALSE;
+}
+
+// Applies a queued event to the window state and reports it to shared code
+//
+static void handleEvent(const _GLFWeventNull* event)
+{
+    _GLFWwindow* window = event->window;
+
+    if (event->type == _GLFW_NULL_EVENT_EMPTY)
+        return;
+
+    // The window may have been destroyed after the event was queued
+    if (!isValidWindow(window))
+        return;
+
+    switch (event->type)
+    {
+        case _GLFW_NULL_EVENT_KEY:
+            _glfwInputKey(window, event->a, event->b, event->c, event->d);
+            break;
+
+        case _GLFW_NULL_EVENT_CHAR:
+            _glfwInputChar(window, (unsigned int) event->a, event->b, GL_TRUE);
+            break;
+
+        case _GLFW_NULL_EVENT_MOUSE_BUTTON:
+            _glfwInputMouseClick(window, event->a, event->b, event->c);
+            break;
+
+        case _GLFW_NULL_EVENT_CURSOR_POS:
+            if (window->cursorMode == GLFW_CURSOR_DISABLED)
+            {
+                _glfwInputCursorMotion(window,
+                                       event->x - window->null.cursorPosX,
+                                       event->y - window->null.cursorPosY);
+            }
+            else
+                _glfwInputCursorMotion(window, event->x, event->y);
+
+            window->null.cursorPosX = event->x;
+            window->null.cursorPosY = event->y;
+            break;
+
+        case _GLFW_NULL_EVENT_SCROLL:
+            _glfwInputScroll(window, event->x, event->y);
+            break;
+
+        case _GLFW_NULL_EVENT_FOCUS:
+            if (event->a)
+            {
+                if (_glfw.null.focusedWindow &&
+                    _glfw.null.focusedWindow != window)
+                {
+                    _glfw.null.focusedWindow->null.focused = GL_FALSE;
+                    _glfwInputWindowFocus(_glfw.null.focusedWindow, GL_FALSE);
+                }
+
+                _glfw.null.focusedWindow = window;
+            }
+            else if (_glfw.null.focusedWindow == window)
+                _glfw.null.focusedWindow = NULL;
+
+            if (window->null.focused != event->a)
+            {
+                window->null.focused = event->a;
+                _glfwInputWindowFocus(window, event->a);
+            }
+            break;
+
+        case _GLFW_NULL_EVENT_ICONIFY:
+            if (window->null.iconified != event->a)
+            {
+                window->null.iconified = event->a;
+                _glfwInputWindowIconify(window, event->a);
+            }
+            break;
+
+        case _GLFW_NULL_EVENT_SIZE:
+            window->null.width = event->a;
+            window->null.height = event->b;
+            _glfwInputWindowSize(window, event->a, event->b);
+            _glfwInputFramebufferSize(window, event->a, event->b);
+            _glfwInputWindowDamage(window);
+            break;
+
+        case _GLFW_NULL_EVENT_CLOSE:
+            _glfwInputWindowCloseRequest(window);
+            break;
+
+        default:
+            break;
+    }
+}
+
+// Queues an event for the specified window
+//
+static void queueWindowEvent(_GLFWwindow* window, _GLFWeventTypeNull type,
+                             int a, int b, int c, int d)
+{
+    _GLFWeventNull event;
+    memset(&event, 0, sizeof(event));
+
+    event.type = type;
+    event.window = window;
+    event.a = a;
+    event.b = b;
+    event.c = c;
+    event.d = d;
+
+    _glfwEnqueueEventNull(&event);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//////                       GLFW internal API                      //////
+//////////////////////////////////////////////////////////////////////////
+
+// Appends an event to the queue and wakes up any waiting thread
+//
+GLboolean _glfwEnqueueEventNull(const _GLFWeventNull* event)
+{
+    GLboolean result = GL_FALSE;
+
+    pthread_mutex_lock(&_glfw.null.eventMutex);
+
+    if (_glfw.null.eventCount < _GLFW_NULL_EVENT_QUEUE_SIZE)
+    {
+        const int tail = (_glfw.null.eventHead + _glfw.null.eventCount) %
+                         _GLFW_NULL_EVENT_QUEUE_SIZE;
+
+        _glfw.null.events[tail] = *event;
+        _glfw.null.eventCount++;
+        result = GL_TRUE;
+    }
+
+    pthread_cond_signal(&_glfw.null.eventCond);
+    pthread_mutex_unlock(&_glfw.null.eventMutex);
+
+    if (!result)
+    {
+        _glfwInputError(GLFW_PLATFORM_ERROR,
+                        "Null: Event queue is full, event dropped");
+    }
+
+    return result;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//////                       GLFW platform API                      //////
+//////////////////////////////////////////////////////////////////////////
+
+int _glfwPlatformCreateWindow(_GLFWwindow* window,
+                              const _GLFWwndconfig* wndconfig,
+                              const _GLFWctxconfig* ctxconfig,
+                              const _GLFWfbconfig* fbconfig)
+{
+    if (wndconfig->monitor)
+    {
+        GLFWvidmode mode;
+        _glfwPlatformGetVideoMode(wndconfig->monitor, &mode);
+
+        window->null.width  = mode.width;
+        window->null.height = mode.height;
+    }
+    else
+    {
+        window->null.width  = wndconfig->width;
+        window->null.height = wndconfig->height;
+    }
+
+    window->null.title = strdup(wndconfig->title ? wndconfig->title : "");
+
+    if (!_glfwCreateContext(window, ctxconfig, fbconfig))
+        return GL_FALSE;
+
+    return GL_TRUE;
+}
+
+void _glfwPlatformDestroyWindow(_GLFWwindow* window)
+{
+    if (_glfw.null.focusedWindow == window)
+        _glfw.null.focusedWindow = NULL;
+
+    _glfwDestroyContext(window);
+
+    free(window->null.title);
+    window->null.title = NULL;
+}
+
+void _glfwPlatformSetWindowTitle(_GLFWwindow* window, const char* title)
+{
+    free(window->null.title);
+    window->null.title = strdup(title ? title : "");
+}
+
+void _glfwPlatformGetWindowPos(_GLFWwindow* window, int* xpos, int* ypos)
+{
+    if (xpos)
+        *xpos = window->null.xpos;
+    if (ypos)
+        *ypos = window->null.ypos;
+}
+
+void _glfwPlatformSetWindowPos(_GLFWwindow* window, int xpos, int ypos)
+{
+    if (window->null.xpos != xpos || window->null.ypos != ypos)
+    {
+        window->null.xpos = xpos;
+        window->null.ypos = ypos;
+        _glfwInputWindowPos(window, xpos, ypos);
+    }
+}
+
+void _glfwPlatformGetWindowSize(_GLFWwindow* window, int* width, int* height)
+{
+    if (width)
+        *width = window->null.width;
+    if (height)
+        *height = window->null.height;
+}
+
+void _glfwPlatformSetWindowSize(_GLFWwindow* window, int width, int height)
+{
+    if (window->null.width != width || window->null.height != height)
+    {
+        window->null.width = width;
+        window->null.height = height;
+        _glfwInputWindowSize(window, width, height);
+        _glfwInputFramebufferSize(window, width, height);
+    }
+}
+
+void _glfwPlatformGetFramebufferSize(_GLFWwindow* window, int* width, int* height)
+{
+    if (width)
+        *width = window->null.width;
+    if (height)
+        *height = window->null.height;
+}
+
+void _glfwPlatformGetWindowFrameSize(_GLFWwindow* window,
+                                     int* left, int* top,
+                                     int* right, int* bottom)
+{
+    if (left)
+        *left = 0;
+    if (top)
+        *top = 0;
+    if (right)
+        *right = 0;
+    if (bottom)
+        *bottom = 0;
+}
+
+void _glfwPlatformIconifyWindow(_GLFWwindow* window)
+{
+    queueWindowEvent(window, _GLFW_NULL_EVENT_ICONIFY, GL_TRUE, 0, 0, 0);
+}
+
+void _glfwPlatformRestoreWindow(_GLFWwindow* window)
+{
+    queueWindowEvent(window, _GLFW_NULL_EVENT_ICONIFY, GL_FALSE, 0, 0, 0);
+}
+
+void _glfwPlatformShowWindow(_GLFWwindow* window)
+{
+    window->null.visible = GL_TRUE;
+    queueWindowEvent(window, _GLFW_NULL_EVENT_FOCUS, GL_TRUE, 0, 0, 0);
+}
+
+void _glfwPlatformUnhideWindow(_GLFWwindow* window)
+{
+    window->null.visible = GL_TRUE;
+}
+
+void _glfwPlatformHideWindow(_GLFWwindow* window)
+{
+    window->null.visible = GL_FALSE;
+    queueWindowEvent(window, _GLFW_NULL_EVENT_FOCUS, GL_FALSE, 0, 0, 0);
+}
+
+int _glfwPlatformWindowFocused(_GLFWwindow* window)
+{
+    return window->null.focused;
+}
+
+int _glfwPlatformWindowIconified(_GLFWwindow* window)
+{
+    return window->null.iconified;
+}
+
+int _glfwPlatformWindowVisible(_GLFWwindow* window)
+{
+    return window->null.visible;
+}
+
+void _glfwPlatformPollEvents(void)
+{
+    _GLFWeventNull event;
+
+    for (;;)
+    {
+        GLboolean found;
+
+        // Dispatch one event at a time without holding the lock, so that
+        // callbacks are free to queue further events
+        pthread_mutex_lock(&_glfw.null.eventMutex);
+        found = dequeueEvent(&event);
+        pthread_mutex_unlock(&_glfw.null.eventMutex);
+
+        if (!found)
+            break;
+
+        handleEvent(&event);
+    }
+}
+
+void _glfwPlatformWaitEvents(void)
+{
+    pthread_mutex_lock(&_glfw.null.eventMutex);
+
+    while (_glfw.null.eventCount == 0)
+        pthread_cond_wait(&_glfw.null.eventCond, &_glfw.null.eventMutex);
+
+    pthread_mutex_unlock(&_glfw.null.eventMutex);
+
+    _glfwPlatformPollEvents();
+}
+
+void _glfwPlatformWaitEventsTimeout(double timeout)
+{
+    struct timespec deadline;
+    time_t seconds;
+
+    // pthread_cond_timedwait takes an absolute CLOCK_REALTIME deadline
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    timeout += deadline.tv_nsec / 1e9;
+    seconds = (time_t) timeout;
+    deadline.tv_sec += seconds;
+    deadline.tv_nsec = (long) ((timeout - (double) seconds) * 1e9);
+
+    pthread_mutex_lock(&_glfw.null.eventMutex);
+
+    while (_glfw.null.eventCount == 0)
+    {
+        if (pthread_cond_timedwait(&_glfw.null.eventCond,
+                                   &_glfw.null.eventMutex,
+                                   &deadline) == ETIMEDOUT)
+            break;
+    }
+
+    pthread_mutex_unlock(&_glfw.null.eventMutex);
+
+    _glfwPlatformPollEvents();
+}
+
+void _glfwPlatformPostEmptyEvent(void)
+{
+    _GLFWeventNull event;
+    memset(&event, 0, sizeof(event));
+    event.type = _GLFW_NULL_EVENT_EMPTY;
+
+    _glfwEnqueueEventNull(&event);
+}
+
+int _glfwPlatformCreateCursor(_GLFWcursor* cursor,
+                              const GLFWimage* image,
+                              int xhot, int yhot)
+{
+    return GL_TRUE;
+}
+
+int _glfwPlatformCreateStandardCursor(_GLFWcursor* cursor, int shape)
+{
+    return GL_TRUE;
+}
+
+void _glfwPlatformDestroyCursor(_GLFWcursor* cursor)
+{
+}
+
+void _glfwPlatformSetCursor(_GLFWwindow* window, _GLFWcursor* cursor)
+{
+}
+
+void _glfwPlatformGetCursorPos(_GLFWwindow* window, double* xpos, double* ypos)
+{
+    if (xpos)
+        *xpos = window->null.cursorPosX;
+    if (ypos)
+        *ypos = window->null.cursorPosY;
+}
+
+void _glfwPlatformSetCursorPos(_GLFWwindow* window, double xpos, double ypos)
+{
+    window->null.cursorPosX = xpos;
+    window->null.cursorPosY = ypos;
+}
+
+void _glfwPlatformApplyCursorMode(_GLFWwindow* window)
+{
+}
+
+void _glfwPlatformSetClipboardString(_GLFWwindow* window, const char* string)
+{
+    free(_glfw.null.clipboardString);
+    _glfw.null.clipboardString = strdup(string);
+}
+
+const char* _glfwPlatformGetClipboardString(_GLFWwindow* window)
+{
+    return _glfw.null.clipboardString;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//////                        GLFW native API                       //////
+//////////////////////////////////////////////////////////////////////////
+
+GLFWAPI void glfwNullInjectKey(GLFWwindow* handle,
+                               int key, int scancode, int action, int mods)
+{
+    _GLFWwindow* window = (_GLFWwindow*) handle;
+    _GLFW_REQUIRE_INIT();
+    queueWindowEvent(window, _GLFW_NULL_EVENT_KEY, key, scancode, action, mods);
+}
+
+GLFWAPI void glfwNullInjectChar(GLFWwindow* handle,
+                                unsigned int codepoint, int mods)
+{
+    _GLFWwindow* window = (_GLFWwindow*) handle;
+    _GLFW_REQUIRE_INIT();
+    queueWindowEvent(window, _GLFW_NULL_EVENT_CHAR, (int) codepoint, mods, 0, 0);
+}
+
+GLFWAPI void glfwNullInjectMouseButton(GLFWwindow* handle,
+                                       int button, int action, int mods)
+{
+    _GLFWwindow* window = (_GLFWwindow*) handle;
+    _GLFW_REQUIRE_INIT();
+    queueWindowEvent(window, _GLFW_NULL_EVENT_MOUSE_BUTTON, button, action, mods, 0);
+}
+
+GLFWAPI void glfwNullInjectCursorPos(GLFWwindow* handle, double xpos, double ypos)
+{
+    _GLFWeventNull event;
+    _GLFW_REQUIRE_INIT();
+
+    memset(&event, 0, sizeof(event));
+    event.type = _GLFW_NULL_EVENT_CURSOR_POS;
+    event.window = (_GLFWwindow*) handle;
+    event.x = xpos;
+    event.y = ypos;
+
+    _glfwEnqueueEventNull(&event);
+}
+
+GLFWAPI void glfwNullInjectScroll(GLFWwindow* handle, double xoffset, double yoffset)
+{
+    _GLFWeventNull event;
+    _GLFW_REQUIRE_INIT();
+
+    memset(&event, 0, sizeof(event));
+    event.type = _GLFW_NULL_EVENT_SCROLL;
+    event.window = (_GLFWwindow*) handle;
+    event.x = xoffset;
+    event.y = yoffset;
+
+    _glfwEnqueueEventNull(&event);
+}
+
+GLFWAPI void glfwNullInjectFocus(GLFWwindow* handle, int focused)
+{
+    _GLFWwindow* window = (_GLFWwindow*) handle;
+    _GLFW_REQUIRE_INIT();
+    queueWindowEvent(window, _GLFW_NULL_EVENT_FOCUS,
+                     focused ? GL_TRUE : GL_FALSE, 0, 0, 0);
+}
+
+GLFWAPI void glfwNullInjectIconify(GLFWwindow* handle, int iconified)
+{
+    _GLFWwindow* window = (_GLFWwindow*) handle;
+    _GLFW_REQUIRE_INIT();
+    queueWindowEvent(window, _GLFW_NULL_EVENT_ICONIFY,
+                     iconified ? GL_TRUE : GL_FALSE, 0, 0, 0);
+}
+
+GLFWAPI void glfwNullInjectResize(GLFWwindow* handle, int width, int height)
+{
+    _GLFWwindow* window = (_GLFWwindow*) handle;
+    _GLFW_REQUIRE_INIT();
+    queueWindowEvent(window, _GLFW_NULL_EVENT_SIZE, width, height, 0, 0);
+}
+
+GLFWAPI void glfwNullInjectClose(GLFWwindow* handle)
+{
+    _GLFWwindow* window = (_GLFWwindow*) handle;
+    _GLFW_REQUIRE_INIT();
+    queueWindowEvent(window, _GLFW_NULL_EVENT_CLOSE, 0, 0, 0, 0);
+}
+
+GLFWAPI int glfwNullGetPendingEventCount(void)
+{
+    int count;
+    _GLFW_REQUIRE_INIT_OR_RETURN(0);
+
+    pthread_mutex_lock(&_glfw.null.eventMutex);
+    count = _glfw.null.eventCount;
+    pthread_mutex_unlock(&_glfw.null.eventMutex);
+
+    return count;
+}
+
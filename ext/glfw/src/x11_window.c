@@ -1834,6 +1834,18 @@ void _glfwPlatformWaitEvents(void)
     _glfwPlatformPollEvents();
 }
 
+void _glfwPlatformWaitEventsTimeout(double timeout)
+{
+    struct timeval tv;
+    tv.tv_sec = (time_t) timeout;
+    tv.tv_usec = (suseconds_t) ((timeout - (double) tv.tv_sec) * 1e6);
+
+    if (!XPending(_glfw.x11.display))
+        selectDisplayConnection(&tv);
+
+    _glfwPlatformPollEvents();
+}
+
 void _glfwPlatformPostEmptyEvent(void)
 {
     XEvent event;
@@ -0,0 +1,254 @@
+#include "BeamSearch.h"
+#include "JobSystem.h"
+#include "Zobrist.h"
+
+#include <algorithm>
+#include <cstring>
+
+const int BeamSearch::MAX_WIDTH;
+const int BeamSearch::MAX_PIECES;
+
+struct BeamSearch::Arena {
+    PlacementFinder finder;
+    FeatureBatch batch;
+    // Per placement of the node being expanded: the board after it, its
+    // hash, score and lines, and where in batch it was measured, -1 when
+    // the table had the score
+    Bitboard boards[PlacementFinder::MAX_PLACEMENTS];
+    uint64_t hashes[PlacementFinder::MAX_PLACEMENTS];
+    float scores[PlacementFinder::MAX_PLACEMENTS];
+    int lines[PlacementFinder::MAX_PLACEMENTS];
+    int slots[PlacementFinder::MAX_PLACEMENTS];
+    // A heap with the worst node on top
+    Node best[MAX_WIDTH];
+    int best_count;
+    long long int nodes;
+    long long int probes;
+    long long int hits;
+    BeamSearch* search;
+    int chunk;
+    JobSystem::Job job;
+};
+
+namespace {
+
+// Higher score first; equal scores are ordered by the rest of the node so
+// the result does not depend on which worker found what
+bool better(const BeamSearch::Node& a, const BeamSearch::Node& b) {
+    if (a.score != b.score) {
+        return a.score > b.score;
+    }
+    if (a.first != b.first) {
+        return a.first < b.first;
+    }
+    return memcmp(a.board.rows, b.board.rows, sizeof(a.board.rows)) < 0;
+}
+
+// Chunks per worker, so a worker that finishes early can take another
+const int CHUNKS_PER_WORKER = 4;
+const int MAX_CHUNKS = 64;
+
+}
+
+BeamSearch::BeamSearch(int width, TranspositionTable* table, const BotWeights& weights)
+    : beam_width(std::min(std::max(width, 1), MAX_WIDTH)), table(table), weights(weights),
+      beam(beam_width), beam_count(0), expand_type(TETRIS_TOTALSHAPE), expand_chunks(0),
+      last_nodes(0), last_probes(0), last_hits(0),
+      last_transpositions(0) {
+}
+
+BeamSearch::~BeamSearch() {
+    for (size_t i = 0; i < arenas.size(); ++i) {
+        delete arenas[i];
+    }
+}
+
+void BeamSearch::expand(Arena& arena, PlacementFinder& finder, const Node& parent,
+                        SHAPE_TYPE type, const PiecePosition& start, bool root) {
+    int count = finder.find(parent.board, type, start);
+    arena.nodes += count;
+    // Children are looked up only when this board was expanded with this
+    // piece before, mostly by the search for the previous piece; others
+    // are rarely in the table and a probe costs about what it saves. The
+    // board's entry flags the pieces it was expanded with.
+    bool expanded = false;
+    if (table != NULL) {
+        uint32_t flag = 1u << type;
+        ++arena.probes;
+        expanded = (table->mark(parent.hash, flag) & flag) != 0;
+    }
+    for (int i = 0; i < count; ++i) {
+        const PiecePosition& position = finder.placement(i).position;
+        arena.boards[i] = parent.board;
+        int cleared = Bot::place(&arena.boards[i], type, position);
+        if (cleared == 0) {
+            coordinate cells[SQUARE_PER_SHAPE];
+            PlacementFinder::cells(type, position, cells);
+            arena.hashes[i] = parent.hash ^ Zobrist::cells(cells);
+        } else {
+            arena.hashes[i] = Zobrist::board(arena.boards[i]);
+        }
+        arena.lines[i] = parent.lines + cleared;
+        if (table != NULL) {
+            table->prefetch(arena.hashes[i]);
+        }
+    }
+
+    arena.batch.count = 0;
+    for (int i = 0; i < count; ++i) {
+        if (expanded) {
+            ++arena.probes;
+            if (table->probe(arena.hashes[i], &arena.scores[i])) {
+                ++arena.hits;
+                arena.slots[i] = -1;
+                continue;
+            }
+        }
+        // Scored without lines, so the table holds what only the board
+        // decides
+        arena.slots[i] = arena.batch.count;
+        Bot::measure(arena.boards[i], 0, &arena.batch);
+    }
+    Bot::score(weights, &arena.batch);
+
+    for (int i = 0; i < count; ++i) {
+        if (arena.slots[i] >= 0) {
+            arena.scores[i] = arena.batch.score[arena.slots[i]];
+            if (table != NULL) {
+                table->store(arena.hashes[i], arena.scores[i]);
+            }
+        }
+        Node child;
+        child.score = arena.scores[i] + weights.lines * arena.lines[i];
+        if (arena.best_count == beam_width && child.score < arena.best[0].score) {
+            continue;
+        }
+        child.board = arena.boards[i];
+        child.hash = arena.hashes[i];
+        child.lines = arena.lines[i];
+        child.first = root ? i : parent.first;
+        if (arena.best_count < beam_width) {
+            arena.best[arena.best_count++] = child;
+            std::push_heap(arena.best, arena.best + arena.best_count, better);
+        } else if (better(child, arena.best[0])) {
+            std::pop_heap(arena.best, arena.best + arena.best_count, better);
+            arena.best[arena.best_count - 1] = child;
+            std::push_heap(arena.best, arena.best + arena.best_count, better);
+        }
+    }
+}
+
+void BeamSearch::expand_chunk(int chunk, int chunks, SHAPE_TYPE type) {
+    Arena& arena = *arenas[chunk];
+    arena.best_count = 0;
+    // Interleaved, so every chunk gets some of the best and some of the
+    // worst states
+    for (int i = chunk; i < beam_count; i += chunks) {
+        expand(arena, arena.finder, beam[i], type, PlacementFinder::spawn(type), false);
+    }
+}
+
+void BeamSearch::expand_job(void* data) {
+    Arena* arena = static_cast<Arena*>(data);
+    BeamSearch* search = arena->search;
+    search->expand_chunk(arena->chunk, search->expand_chunks, search->expand_type);
+}
+
+int BeamSearch::merge(int chunks) {
+    int count = 0;
+    for (int c = 0; c < chunks; ++c) {
+        const Arena& arena = *arenas[c];
+        std::copy(arena.best, arena.best + arena.best_count, merged.begin() + count);
+        count += arena.best_count;
+    }
+    // Best first, so of the states with the same board the best one stays
+    std::sort(merged.begin(), merged.begin() + count, better);
+    const int SEEN_SLOTS = 2 * MAX_WIDTH;
+    uint64_t seen[SEEN_SLOTS];
+    bool taken[SEEN_SLOTS] = {false};
+    int kept = 0;
+    for (int i = 0; i < count && kept < beam_width; ++i) {
+        uint64_t hash = merged[i].hash;
+        int slot = (int)(hash % SEEN_SLOTS);
+        while (taken[slot] && seen[slot] != hash) {
+            slot = (slot + 1) % SEEN_SLOTS;
+        }
+        if (taken[slot]) {
+            ++last_transpositions;
+            continue;
+        }
+        taken[slot] = true;
+        seen[slot] = hash;
+        beam[kept++] = merged[i];
+    }
+    return kept;
+}
+
+int BeamSearch::choose(const Bitboard& board, const SHAPE_TYPE* pieces, int count,
+                       const PiecePosition& start) {
+    count = std::min(count, MAX_PIECES);
+    int chunks = std::min(JobSystem::worker_count() * CHUNKS_PER_WORKER, MAX_CHUNKS);
+    while ((int)arenas.size() < chunks) {
+        Arena* arena = new Arena();
+        arena->search = this;
+        arena->chunk = (int)arenas.size();
+        arenas.push_back(arena);
+    }
+    if ((int)merged.size() < chunks * beam_width) {
+        merged.resize(chunks * beam_width);
+    }
+    for (int c = 0; c < chunks; ++c) {
+        arenas[c]->nodes = 0;
+        arenas[c]->probes = 0;
+        arenas[c]->hits = 0;
+    }
+    last_transpositions = 0;
+    if (table != NULL) {
+        table->new_search();
+    }
+
+    // The current piece is placed from where it is, with the finder whose
+    // placements the result indexes
+    Node root;
+    root.board = board;
+    root.hash = Zobrist::board(board);
+    root.score = 0.f;
+    root.lines = 0;
+    root.first = -1;
+    arenas[0]->best_count = 0;
+    expand(*arenas[0], root_finder, root, pieces[0], start, true);
+    beam_count = merge(1);
+
+    for (int depth = 1; depth < count && beam_count > 0; ++depth) {
+        int used = std::min(chunks, beam_count);
+        expand_type = pieces[depth];
+        expand_chunks = used;
+        {
+            JobSystem::TaskGroup group;
+            for (int c = 1; c < used; ++c) {
+                group.run(&arenas[c]->job, expand_job, arenas[c]);
+            }
+            expand_chunk(0, used, expand_type);
+            group.wait();
+        }
+        int next = merge(used);
+        if (next == 0) {
+            // Every line tops out here, go by the depth before
+            break;
+        }
+        beam_count = next;
+    }
+
+    last_nodes = 0;
+    last_probes = 0;
+    last_hits = 0;
+    for (int c = 0; c < chunks; ++c) {
+        last_nodes += arenas[c]->nodes;
+        last_probes += arenas[c]->probes;
+        last_hits += arenas[c]->hits;
+    }
+    if (beam_count == 0) {
+        return -1;
+    }
+    return std::min_element(beam.begin(), beam.begin() + beam_count, better)->first;
+}
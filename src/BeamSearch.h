@@ -0,0 +1,99 @@
+#ifndef BEAM_SEARCH_H
+#define BEAM_SEARCH_H
+
+#include "Bot.h"
+#include "TranspositionTable.h"
+
+#include <vector>
+
+// Plans the current piece a few pieces ahead. Every placement of the
+// current piece is one state; each further known piece expands every
+// state by all of that piece's placements, and only the width best
+// states, by the Bot score of their board, are kept for the next depth.
+// The current piece goes where the best final state started.
+//
+// Each depth expands the beam in chunks on the JobSystem. A chunk works
+// in its own arena, a finder, a feature batch and its best width states,
+// so workers share nothing until the chunks are merged. Arenas are made
+// by the first search and reused, nothing is allocated after that, not
+// even for the jobs.
+//
+// Every state carries the Zobrist hash of its board. Boards reached in
+// more than one way are kept once when the chunks are merged. With a
+// TranspositionTable, expanding a board with a piece it was expanded with
+// before, by any thread or for an earlier piece, takes the children's
+// scores from the table; a flag on the board's entry per piece type
+// records the expansions. MonteCarloSearch does not use a table.
+//
+// Keeps its arenas between calls, so use one search per thread.
+class BeamSearch {
+public:
+    static const int MAX_WIDTH = 256;
+    // The current piece and the preview
+    static const int MAX_PIECES = 8;
+
+    // table may be shared with other searches, or NULL
+    explicit BeamSearch(int width = 32, TranspositionTable* table = NULL,
+                        const BotWeights& weights = BotWeights::defaults());
+    ~BeamSearch();
+
+    BeamSearch(const BeamSearch&) = delete;
+    BeamSearch& operator=(const BeamSearch&) = delete;
+
+    // pieces[0] is the current piece, at start; the others follow in
+    // order from their spawn. Returns the index into finder() of where
+    // the current piece should go, -1 when the start is blocked.
+    int choose(const Bitboard& board, const SHAPE_TYPE* pieces, int count,
+               const PiecePosition& start);
+
+    const PlacementFinder& finder() const { return root_finder; }
+    int width() const { return beam_width; }
+    // Of the last choose(): boards reached; table lookups, one per board
+    // expanded for its flags and one per child of a board expanded with
+    // the same piece before, and the children's scores found; and states
+    // dropped as the same board as a better one
+    long long int nodes() const { return last_nodes; }
+    long long int table_probes() const { return last_probes; }
+    long long int table_hits() const { return last_hits; }
+    long long int transpositions() const { return last_transpositions; }
+
+    // A state of the beam: the board after some placements and the
+    // placement of the current piece it started from
+    struct Node {
+        Bitboard board;
+        uint64_t hash;
+        float score;
+        int lines;
+        int first;
+    };
+
+    // Scratch space of one chunk, defined in BeamSearch.cpp
+    struct Arena;
+
+private:
+    void expand(Arena& arena, PlacementFinder& finder, const Node& parent, SHAPE_TYPE type,
+                const PiecePosition& start, bool root);
+    void expand_chunk(int chunk, int chunks, SHAPE_TYPE type);
+    // A JobSystem job expanding the chunk of an arena
+    static void expand_job(void* arena);
+    // Keeps the best width nodes of all arenas in beam, returns how many
+    int merge(int chunks);
+
+    int beam_width;
+    TranspositionTable* table;
+    BotWeights weights;
+    PlacementFinder root_finder;
+    std::vector<Arena*> arenas;
+    std::vector<Node> beam;
+    std::vector<Node> merged;
+    int beam_count;
+    // The depth being expanded, for expand_job()
+    SHAPE_TYPE expand_type;
+    int expand_chunks;
+    long long int last_nodes;
+    long long int last_probes;
+    long long int last_hits;
+    long long int last_transpositions;
+};
+
+#endif
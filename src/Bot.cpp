@@ -0,0 +1,176 @@
+#include "Bot.h"
+
+#include <cstdlib>
+
+namespace {
+
+const uint32_t FULL_ROW = (1u << TOTAL_COLS) - 1;
+
+inline int bit_count(uint32_t mask) {
+#if defined(__GNUC__)
+    return __builtin_popcount(mask);
+#else
+    int count = 0;
+    for (; mask != 0; mask &= mask - 1) {
+        ++count;
+    }
+    return count;
+#endif
+}
+
+inline int lowest_bit(uint32_t mask) {
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#else
+    int bit = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+}
+
+BotWeights BotWeights::defaults() {
+    // Height, holes, bumpiness and lines as commonly published, holes
+    // weighted up; bot_bench games go past 100000 pieces with these
+    BotWeights weights;
+    weights.aggregate_height = -0.51f;
+    weights.holes = -4.0f;
+    weights.bumpiness = -0.18f;
+    weights.row_transitions = -0.6f;
+    weights.column_transitions = -1.0f;
+    weights.wells = -0.35f;
+    weights.lines = 0.76f;
+    return weights;
+}
+
+Bot::Bot(const BotWeights& weights) : bot_weights(weights) {
+    batch.count = 0;
+}
+
+int Bot::place(Bitboard* board, SHAPE_TYPE type, const PiecePosition& position) {
+    coordinate cells[SQUARE_PER_SHAPE];
+    PlacementFinder::cells(type, position, cells);
+    for (unsigned int i = 0; i < SQUARE_PER_SHAPE; ++i) {
+        board->rows[cells[i].x] |= 1u << cells[i].y;
+    }
+    int cleared = 0;
+    int to = TOTAL_ROWS - 1;
+    for (int r = TOTAL_ROWS - 1; r >= 0; --r) {
+        if (board->rows[r] == FULL_ROW) {
+            ++cleared;
+        } else {
+            board->rows[to--] = board->rows[r];
+        }
+    }
+    for (; to >= 0; --to) {
+        board->rows[to] = 0;
+    }
+    return cleared;
+}
+
+void Bot::measure(const Bitboard& board, int lines, FeatureBatch* batch) {
+    // One pass from the top; walls and the floor count as filled, empty rows
+    // have no transitions
+    int heights[TOTAL_COLS] = {0};
+    uint32_t well_rows[TOTAL_ROWS];
+    uint32_t covered = 0;
+    int height = 0;
+    int holes = 0;
+    int row_transitions = 0;
+    int column_transitions = 0;
+    int wells = 0;
+    // Rows above the stack add nothing
+    int top = 0;
+    while (top < TOTAL_ROWS && board.rows[top] == 0) {
+        ++top;
+    }
+    for (int r = top; r < TOTAL_ROWS; ++r) {
+        uint32_t row = board.rows[r];
+        holes += bit_count(~row & covered);
+        for (uint32_t tops = row & ~covered; tops != 0; tops &= tops - 1) {
+            heights[lowest_bit(tops)] = TOTAL_ROWS - r;
+        }
+        covered |= row;
+        height += bit_count(covered);
+
+        if (row != 0) {
+            uint32_t walled = (row << 1) | 1u | (1u << (TOTAL_COLS + 1));
+            row_transitions += bit_count((walled ^ (walled >> 1)) & ((FULL_ROW << 1) | 1u));
+        }
+        if (r > 0) {
+            column_transitions += bit_count(row ^ board.rows[r - 1]);
+        }
+
+        // Open cells with something on both sides, each counting as deep
+        // as the well is down to it
+        uint32_t left = (row << 1) | 1u;
+        uint32_t right = (row >> 1) | (1u << (TOTAL_COLS - 1));
+        well_rows[r] = ~covered & left & right & FULL_ROW;
+        uint32_t deeper = well_rows[r];
+        for (int k = r; deeper != 0; ) {
+            wells += bit_count(deeper);
+            if (--k < top) {
+                break;
+            }
+            deeper &= well_rows[k];
+        }
+    }
+    column_transitions += bit_count(~board.rows[TOTAL_ROWS - 1] & FULL_ROW);
+    int bumpiness = 0;
+    for (int c = 0; c + 1 < TOTAL_COLS; ++c) {
+        bumpiness += std::abs(heights[c] - heights[c + 1]);
+    }
+
+    int i = batch->count++;
+    batch->aggregate_height[i] = (float)height;
+    batch->holes[i] = (float)holes;
+    batch->bumpiness[i] = (float)bumpiness;
+    batch->row_transitions[i] = (float)row_transitions;
+    batch->column_transitions[i] = (float)column_transitions;
+    batch->wells[i] = (float)wells;
+    batch->lines[i] = (float)lines;
+}
+
+void Bot::score(const BotWeights& weights, FeatureBatch* batch) {
+    // Straight-line multiply-adds over the arrays, which the compiler turns
+    // into vector code
+    const float* __restrict height = batch->aggregate_height;
+    const float* __restrict holes = batch->holes;
+    const float* __restrict bumpiness = batch->bumpiness;
+    const float* __restrict row_transitions = batch->row_transitions;
+    const float* __restrict column_transitions = batch->column_transitions;
+    const float* __restrict wells = batch->wells;
+    const float* __restrict lines = batch->lines;
+    float* __restrict score = batch->score;
+    int count = batch->count;
+    for (int i = 0; i < count; ++i) {
+        score[i] = weights.aggregate_height * height[i] + weights.holes * holes[i] +
+                   weights.bumpiness * bumpiness[i] +
+                   weights.row_transitions * row_transitions[i] +
+                   weights.column_transitions * column_transitions[i] +
+                   weights.wells * wells[i] + weights.lines * lines[i];
+    }
+}
+
+int Bot::choose(const Bitboard& board, SHAPE_TYPE type, const PiecePosition& start) {
+    int count = placement_finder.find(board, type, start);
+    batch.count = 0;
+    for (int i = 0; i < count; ++i) {
+        Bitboard after = board;
+        int lines = place(&after, type, placement_finder.placement(i).position);
+        measure(after, lines, &batch);
+    }
+    score(bot_weights, &batch);
+    // Placements come shortest path first, so the first best one wins
+    int best = -1;
+    for (int i = 0; i < count; ++i) {
+        if (best < 0 || batch.score[i] > batch.score[best]) {
+            best = i;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,63 @@
+#ifndef BOT_H
+#define BOT_H
+
+#include "Placements.h"
+
+// Weight of each board feature in a board's score, higher scores are better
+struct BotWeights {
+    float aggregate_height;
+    float holes;
+    float bumpiness;
+    float row_transitions;
+    float column_transitions;
+    float wells;
+    float lines;
+
+    static BotWeights defaults();
+};
+
+// Features of a batch of candidate boards, one array per feature, so
+// scoring the batch is a single pass over contiguous floats. Aligned only
+// as far as new guarantees before C++17.
+struct FeatureBatch {
+    static const int CAPACITY = PlacementFinder::MAX_PLACEMENTS;
+
+    int count;
+    alignas(16) float aggregate_height[CAPACITY];
+    alignas(16) float holes[CAPACITY];
+    alignas(16) float bumpiness[CAPACITY];
+    alignas(16) float row_transitions[CAPACITY];
+    alignas(16) float column_transitions[CAPACITY];
+    alignas(16) float wells[CAPACITY];
+    alignas(16) float lines[CAPACITY];
+    alignas(16) float score[CAPACITY];
+};
+
+// Plays by trying every placement PlacementFinder finds for the current
+// piece and keeping the one whose resulting board scores best. Holds its
+// finder and batch between calls, so use one bot per thread.
+class Bot {
+public:
+    explicit Bot(const BotWeights& weights = BotWeights::defaults());
+
+    // Locks a piece at position and clears full rows; returns how many
+    static int place(Bitboard* board, SHAPE_TYPE type, const PiecePosition& position);
+    // Appends the features of board, which cleared lines rows, to batch
+    static void measure(const Bitboard& board, int lines, FeatureBatch* batch);
+    // Fills batch->score
+    static void score(const BotWeights& weights, FeatureBatch* batch);
+
+    // Index into finder() of the best placement, -1 when the start is
+    // blocked. Ties go to the shorter path.
+    int choose(const Bitboard& board, SHAPE_TYPE type, const PiecePosition& start);
+
+    const PlacementFinder& finder() const { return placement_finder; }
+    const BotWeights& weights() const { return bot_weights; }
+
+private:
+    BotWeights bot_weights;
+    PlacementFinder placement_finder;
+    FeatureBatch batch;
+};
+
+#endif
@@ -0,0 +1,126 @@
+#include "GpuTimers.h"
+
+#include <algorithm>
+
+const char* GpuTimers::names[TOTAL_PASSES] = {
+    "clear", "board", "particles", "present", "hud"
+};
+
+bool GpuTimers::supported = false;
+GLuint GpuTimers::queries[LATENCY][TOTAL_PASSES];
+bool GpuTimers::issued[LATENCY][TOTAL_PASSES];
+int GpuTimers::slot = 0;
+int GpuTimers::active = -1;
+long long int GpuTimers::late = 0;
+
+double GpuTimers::last_ms[TOTAL_PASSES];
+double GpuTimers::history[TOTAL_PASSES][HISTORY];
+long long int GpuTimers::samples[TOTAL_PASSES];
+
+void GpuTimers::init() {
+#if defined(__APPLE__)
+    supported = true;
+#elif defined(TETRIS_GL_LOADER)
+    supported = gl_loader_version_at_least(3, 3) ||
+                gl_loader_has_extension("GL_ARB_timer_query");
+#else
+    // Timer queries are core since 3.3, we only ask for a 3.2 context
+    supported = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+#endif
+    slot = 0;
+    active = -1;
+    late = 0;
+    for (int p = 0; p < TOTAL_PASSES; ++p) {
+        last_ms[p] = 0.;
+        samples[p] = 0;
+        for (int i = 0; i < HISTORY; ++i) {
+            history[p][i] = 0.;
+        }
+        for (int s = 0; s < LATENCY; ++s) {
+            issued[s][p] = false;
+        }
+    }
+
+    if (!supported) {
+        return;
+    }
+    glGenQueries(LATENCY * TOTAL_PASSES, &queries[0][0]);
+    check_gl_error();
+}
+
+void GpuTimers::teardown() {
+    if (supported) {
+        glDeleteQueries(LATENCY * TOTAL_PASSES, &queries[0][0]);
+    }
+    supported = false;
+}
+
+void GpuTimers::begin(PASS pass) {
+    if (!supported || active >= 0) {
+        return;
+    }
+    // The query of LATENCY frames ago has not landed yet, skip this sample
+    // rather than overwrite it
+    if (issued[slot][pass]) {
+        ++late;
+        return;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, queries[slot][pass]);
+    active = pass;
+}
+
+void GpuTimers::end() {
+    if (!supported || active < 0) {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    issued[slot][active] = true;
+    active = -1;
+}
+
+void GpuTimers::end_frame() {
+    if (!supported) {
+        return;
+    }
+    end();
+
+    // The next slot holds the oldest queries in flight
+    slot = (slot + 1) % LATENCY;
+    for (int p = 0; p < TOTAL_PASSES; ++p) {
+        if (!issued[slot][p]) {
+            continue;
+        }
+
+        GLint available = 0;
+        glGetQueryObjectiv(queries[slot][p], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            continue;
+        }
+        issued[slot][p] = false;
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(queries[slot][p], GL_QUERY_RESULT, &ns);
+        last_ms[p] = ns / 1e6;
+        history[p][samples[p]++ % HISTORY] = last_ms[p];
+    }
+    check_gl_error();
+}
+
+double GpuTimers::average_ms(PASS pass) {
+    long long int n = std::min(samples[pass], (long long int)HISTORY);
+    if (n == 0) {
+        return 0.;
+    }
+    double sum = 0.;
+    for (int i = 0; i < n; ++i) {
+        sum += history[pass][i];
+    }
+    return sum / n;
+}
+
+double GpuTimers::max_ms(PASS pass) {
+    double m = 0.;
+    for (int i = 0; i < HISTORY; ++i) {
+        m = std::max(m, history[pass][i]);
+    }
+    return m;
+}
@@ -0,0 +1,53 @@
+#ifndef GPU_TIMERS_H
+#define GPU_TIMERS_H
+
+#include "Helpers.h"
+
+// GPU time spent in each render pass, measured with GL_TIME_ELAPSED queries.
+// Every pass owns one query per in-flight frame; a result is only read when
+// its slot comes round again LATENCY frames later, so reading never stalls
+// the pipeline. While a result is still pending its pass is not measured
+// again in that slot; those skipped samples are counted in late.
+class GpuTimers {
+public:
+    enum PASS {
+        PASS_CLEAR,
+        PASS_BOARD,
+        PASS_PARTICLES,
+        PASS_PRESENT,
+        PASS_HUD,
+        TOTAL_PASSES
+    };
+    static const int LATENCY = 4;
+    static const int HISTORY = 60;
+
+    static const char* names[TOTAL_PASSES];
+
+    // False when the context has no timer queries, every call is then a no-op
+    static bool supported;
+    static GLuint queries[LATENCY][TOTAL_PASSES];
+    static bool issued[LATENCY][TOTAL_PASSES];
+    static int slot;
+    static int active;
+    static long long int late;
+
+    static double last_ms[TOTAL_PASSES];
+    static double history[TOTAL_PASSES][HISTORY];
+    static long long int samples[TOTAL_PASSES];
+
+    static void init();
+    static void teardown();
+
+    // Passes are measured one at a time, they can not be nested
+    static void begin(PASS pass);
+    static void end();
+
+    // Collects the results of LATENCY frames ago and moves to the next slot
+    static void end_frame();
+
+    // Statistics over the last HISTORY results of a pass
+    static double average_ms(PASS pass);
+    static double max_ms(PASS pass);
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef HANDOFF_H
+#define HANDOFF_H
+
+#include <atomic>
+#include <cstddef>
+
+// Lock-free containers for handing data from the simulation thread to the
+// render thread and back. Each has exactly one producer and one consumer.
+
+// Latest-value handoff. The producer fills write_buffer() and publishes it;
+// the consumer calls update() and reads read_buffer(), which stays valid
+// until its next update(). Neither side ever waits: the three slots are
+// owned by the producer, the consumer and the exchange in between, and a
+// publish the consumer never saw is simply overwritten by the next one.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : middle(1), back(2), front(0) {}
+
+    T& write_buffer() { return slots[back]; }
+
+    void publish() {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Takes the newest published value, returns false when there is none
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    const T& read_buffer() const { return slots[front]; }
+
+private:
+    static const int INDEX = 3;
+    static const int FRESH = 4;
+
+    T slots[3];
+    // Slot index in the low bits, FRESH when published but not yet taken
+    std::atomic<int> middle;
+    int back;
+    int front;
+};
+
+// Bounded FIFO, for events that must not be dropped the way an old
+// snapshot may be. push() fails instead of blocking when the ring is full.
+template <typename T, size_t N>
+class SpscRing {
+public:
+    SpscRing() : head(0), tail(0) {}
+
+    bool push(const T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+        items[h % N] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Copies the oldest item without removing it
+    bool peek(T* item) const {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        *item = items[t % N];
+        return true;
+    }
+
+    bool pop(T* item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        *item = items[t % N];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    T items[N];
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+};
+
+#endif
@@ -1,8 +1,11 @@
 #include "Helpers.h"
+#include "Log.h"
+#include "Zobrist.h"
 
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 
 
 const double EPSILON = 0.00000001;
@@ -42,6 +45,12 @@ void VertexBufferObject::bind()
 
 void VertexBufferObject::free()
 {
+  for (int i = 0; i < MAX_REGIONS; ++i)
+  {
+    if (fences[i])
+      glDeleteSync(fences[i]);
+    fences[i] = 0;
+  }
   glDeleteBuffers(1,&id);
   check_gl_error();
 }
@@ -56,6 +65,130 @@ void VertexBufferObject::update(const Eigen::MatrixXf& M)
   check_gl_error();
 }
 
+void VertexBufferObject::stream(const Eigen::MatrixXf& M, GLuint n)
+{
+  assert(id != 0);
+  assert(n <= M.cols());
+  glBindBuffer(GL_ARRAY_BUFFER, id);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(float)*M.rows()*n, M.data(), GL_STREAM_DRAW);
+  rows = M.rows();
+  cols = n;
+  check_gl_error();
+}
+
+void VertexBufferObject::init_regions(GLuint count, GLuint r, GLuint c)
+{
+  assert(id != 0);
+  assert(count > 0 && count <= MAX_REGIONS);
+  glBindBuffer(GL_ARRAY_BUFFER, id);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(float)*count*r*c, NULL, GL_STREAM_DRAW);
+  region_count = count;
+  region = count - 1;
+  rows = r;
+  cols = c;
+  check_gl_error();
+}
+
+float* VertexBufferObject::map_region()
+{
+  assert(region_count > 0);
+  region = (region + 1) % region_count;
+  ++region_maps;
+
+  GLsync& fence = fences[region];
+  if (fence)
+  {
+    // Poll first so an idle GPU costs no more than one query
+    GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+    {
+      ++region_waits;
+      auto start = std::chrono::high_resolution_clock::now();
+      while (status == GL_TIMEOUT_EXPIRED)
+        status = glClientWaitSync(fence, 0, 1000000);
+      region_wait_ms += std::chrono::duration<double, std::milli>(
+              std::chrono::high_resolution_clock::now() - start).count();
+    }
+    glDeleteSync(fence);
+    fence = 0;
+  }
+
+  glBindBuffer(GL_ARRAY_BUFFER, id);
+  void* ptr = glMapBufferRange(GL_ARRAY_BUFFER, sizeof(float)*region_offset(),
+                               sizeof(float)*rows*cols,
+                               GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                               GL_MAP_UNSYNCHRONIZED_BIT);
+  check_gl_error();
+  return static_cast<float*>(ptr);
+}
+
+void VertexBufferObject::unmap_region()
+{
+  glBindBuffer(GL_ARRAY_BUFFER, id);
+  glUnmapBuffer(GL_ARRAY_BUFFER);
+  check_gl_error();
+}
+
+void VertexBufferObject::write_region(const Eigen::MatrixXf& M, GLuint n)
+{
+  assert(M.rows() == rows);
+  assert(n <= cols && n <= M.cols());
+  float* dst = map_region();
+  std::copy(M.data(), M.data() + rows*n, dst);
+  unmap_region();
+}
+
+void VertexBufferObject::fence_region()
+{
+  assert(fences[region] == 0);
+  fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  check_gl_error();
+}
+
+void VertexBufferObject::refence_region()
+{
+  if (fences[region])
+  {
+    glDeleteSync(fences[region]);
+    fences[region] = 0;
+  }
+  fence_region();
+}
+
+void Texture::init()
+{
+  glGenTextures(1, &id);
+  check_gl_error();
+}
+
+void Texture::update(GLuint w, GLuint h, const unsigned char* pixels)
+{
+  assert(id != 0);
+  glBindTexture(GL_TEXTURE_2D, id);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, w, h, 0, GL_RED, GL_UNSIGNED_BYTE, pixels);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  width = w;
+  height = h;
+  check_gl_error();
+}
+
+void Texture::bind()
+{
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, id);
+  check_gl_error();
+}
+
+void Texture::free()
+{
+  glDeleteTextures(1, &id);
+  check_gl_error();
+}
+
 bool Program::init(
   const std::string &vertex_shader_string,
   const std::string &fragment_shader_string,
@@ -127,6 +260,28 @@ GLint Program::bindVertexAttribArray(
   return id;
 }
 
+GLint Program::bindVertexAttribArray(
+        const std::string &name, VertexBufferObject& VBO,
+        GLint size, GLuint offset) const
+{
+  GLint id = attrib(name);
+  if (id < 0)
+    return id;
+  if (VBO.id == 0)
+  {
+    glDisableVertexAttribArray(id);
+    return id;
+  }
+  VBO.bind();
+  glEnableVertexAttribArray(id);
+  glVertexAttribPointer(id, size, GL_FLOAT, GL_FALSE,
+                        VBO.rows * sizeof(float),
+                        (const void*)(offset * sizeof(float)));
+  check_gl_error();
+
+  return id;
+}
+
 void Program::free()
 {
   if (program_shader)
@@ -202,10 +357,53 @@ void _check_gl_error(const char *file, int line)
   }
 }
 
-const int TOTAL_ROWS = 20;
-const int TOTAL_COLS = 20;
-
 extern bool board_grid[TOTAL_ROWS][TOTAL_COLS];
+// Zobrist::board() of board_grid, persist() adds the piece to it
+extern uint64_t board_hash;
+// board_grid by row and by column, persist() adds the piece to them too
+extern uint32_t board_row_bits[TOTAL_ROWS];
+extern uint32_t board_col_bits[TOTAL_COLS];
+
+namespace {
+
+inline int lowest_bit(uint32_t mask) {
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#else
+    int bit = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+inline int highest_bit(uint32_t mask) {
+#if defined(__GNUC__)
+    return 31 - __builtin_clz(mask);
+#else
+    int bit = 31;
+    while (!(mask & 0x80000000u)) {
+        mask <<= 1;
+        --bit;
+    }
+    return bit;
+#endif
+}
+
+// Empty cells from pos to the first filled one or the end of a line of size
+// cells, stepping by step (1 or -1); bit i of line is set when i is filled
+int free_cells(uint32_t line, int pos, int step, int size) {
+    if (step > 0) {
+        uint32_t ahead = line >> (pos + 1);
+        return ahead ? lowest_bit(ahead) : size - 1 - pos;
+    }
+    uint32_t behind = line & ((1u << pos) - 1);
+    return behind ? pos - 1 - highest_bit(behind) : pos;
+}
+
+}
 
 Program OglRect::program;
 const GLchar* OglRect::vertex_shader =
@@ -245,8 +443,7 @@ VertexArrayObject OglRect::VAO;
 VertexBufferObject OglRect::VBO;
 VertexBufferObject OglRect::VBO_C;
 
-void OglRect::init() {
-    
+void OglRect::prepare() {
     V.resize(2, 3 * SQUARE_TRIANGLE_NUM * TOTAL_SQUARE_NUM);
     Eigen::MatrixXf onesquare(2, 3 * SQUARE_TRIANGLE_NUM);
     onesquare << -0.5, -0.5, 0.,  -0.5, 0.,  0., 
@@ -268,6 +465,12 @@ void OglRect::init() {
         C.col(ind*3 + 1) = C1.col(1);
         C.col(ind*3 + 2) = C1.col(2);
     }
+}
+
+void OglRect::init() {
+    if (V.cols() == 0) {
+        prepare();
+    }
     program.init(vertex_shader,fragment_shader,"outColor");
     program.bind();
 
@@ -308,6 +511,13 @@ void OglRect::render() {
     glDrawArrays(GL_TRIANGLES, 0, TOTAL_TRIANGLES);
 }
 
+void OglRect::render_offset(float dx, float dy) {
+    Eigen::Matrix4f saved = model;
+    translate(dx, dy);
+    render();
+    model = saved;
+}
+
 void OglRect::scale(float fac) {
     Eigen::Matrix4f scl = Eigen::Matrix4f::Identity();
     scl(0, 0) *= fac;
@@ -373,6 +583,7 @@ TetrisShape::TetrisShape(SHAPE_TYPE t): stype(t) {
         default:
             break;
     }
+    hash = Zobrist::piece(stype, cdnt);
 }
 
 int TetrisShape::leftmost() {
@@ -408,18 +619,21 @@ int TetrisShape::downmost() {
 }
 
 void TetrisShape::move_left() {
+    hash ^= Zobrist::piece_move(stype, cdnt, 0, -1);
     for (int i = 0; i < SQUARE_PER_SHAPE; ++i) {
         cdnt[i].move_left();
     }
 }
 
 void TetrisShape::move_right() {
+    hash ^= Zobrist::piece_move(stype, cdnt, 0, 1);
     for (int i = 0; i < SQUARE_PER_SHAPE; ++i) {
         cdnt[i].move_right();
     }
 }
 
 void TetrisShape::move_down() {
+    hash ^= Zobrist::piece_move(stype, cdnt, 1, 0);
     for (int i = 0; i < SQUARE_PER_SHAPE; ++i) {
         cdnt[i].move_down();
     }
@@ -465,7 +679,10 @@ bool TetrisShape::is_display(int _x, int _y) {
 void TetrisShape::persist() {
     for (int i = 0; i < SQUARE_PER_SHAPE; ++i) {
         board_grid[cdnt[i].x][cdnt[i].y] = true;
+        board_row_bits[cdnt[i].x] |= 1u << cdnt[i].y;
+        board_col_bits[cdnt[i].y] |= 1u << cdnt[i].x;
     }
+    board_hash ^= Zobrist::cells(cdnt);
 }
 
 bool TetrisShape::can_morph_stripe() {
@@ -497,16 +714,16 @@ bool TetrisShape::can_lshape_down_to_left() {
     for (int i = 0; i < SQUARE_PER_SHAPE - 1; ++i) {
         if ( (cdnt[2].x + i > 19) ||
               board_grid[cdnt[2].x + i][cdnt[2].y]) {
-            std::cout << "i is %d\n";
+            LOG_DEBUG("%s: blocked at row offset %d", __func__, i);
             return false;
         }
     }
     if ((cdnt[1].x + 2 > 19) ||
           board_grid[cdnt[1].x + 2][cdnt[2].y]) {
-        std::cout << "last i false\n";
+        LOG_DEBUG("%s: blocked at row offset 2", __func__);
         return false;
     }
-    std::cout << "is less than:" << (downmost() < 19) << "\n";
+    LOG_DEBUG("%s: above the floor %d", __func__, downmost() < 19);
     return downmost() < 19;
 }
 
@@ -554,7 +771,7 @@ bool TetrisShape::can_lshape_right_to_down() {
 }
 
 bool TetrisShape::can_morph_lshape() {
-    std::cout << "enter can_morph_lshape \n";
+    LOG_DEBUG("can_morph_lshape: subtype %d", shsubtype);
     switch (shsubtype) {
         case LSHAPE_DOWN:
             // shsubtype = LSHAPE_LEFT;
@@ -575,7 +792,7 @@ bool TetrisShape::can_morph_lshape() {
         default:
             break;
     }
-    std::cout << "can_morph_lshape returns false";
+    LOG_DEBUG("can_morph_lshape returns false");
     return false;
 }
 
@@ -676,7 +893,7 @@ bool TetrisShape::can_morph_gammashape() {
         default:
             break;
     }
-    std::cout << "can_morph_gammashape returns false";
+    LOG_DEBUG("can_morph_gammashape returns false");
     return false;
 }
 
@@ -684,16 +901,16 @@ bool TetrisShape::can_gammashape_down_to_right() {
     for (int i = 0; i < SQUARE_PER_SHAPE - 1; ++i) {
         if ( (cdnt[2].x + i > 19) ||
               board_grid[cdnt[2].x + i][cdnt[2].y]) {
-            std::cout << "i is %d\n";
+            LOG_DEBUG("%s: blocked at row offset %d", __func__, i);
             return false;
         }
     }
     if ((cdnt[1].x + 2 > 19) ||
           board_grid[cdnt[1].x + 2][cdnt[2].y]) {
-        std::cout << "last i false\n";
+        LOG_DEBUG("%s: blocked at row offset 2", __func__);
         return false;
     }
-    std::cout << "is less than:" << (downmost() < 19) << "\n";
+    LOG_DEBUG("%s: above the floor %d", __func__, downmost() < 19);
     return downmost() < 19;
 }
 
@@ -974,10 +1191,11 @@ bool TetrisShape::can_morph() {
         case TETRIS_STRIPSHAPE:
             return can_morph_stripe();
             break;
-        case TETRIS_LSHAPE:
-            std::cout << "can morph:" << can_morph_lshape() << "\n";
-            return can_morph_lshape();
-            break;
+        case TETRIS_LSHAPE: {
+            bool result = can_morph_lshape();
+            LOG_DEBUG("can morph: %d", result);
+            return result;
+        }
         case TETRIS_GAMMASHAPE:
             return can_morph_gammashape();
             break;
@@ -998,7 +1216,7 @@ bool TetrisShape::can_morph() {
             break;
     }
 
-    std::cout << "return false in can morph\n";
+    LOG_DEBUG("return false in can morph");
     return false;
 }
 
@@ -1027,10 +1245,32 @@ void TetrisShape::morph() {
         default:
             break;
     }
+    // A rotation moves most cells, hash them all again
+    hash = Zobrist::piece(stype, cdnt);
 }
 
 void TetrisShape::move_to_bottom() {
-    while (can_move_down()) {
-        move_down();
+    shift(distance(1, 0), 0);
+}
+
+void TetrisShape::shift(int dr, int dc) {
+    hash ^= Zobrist::piece_move(stype, cdnt, dr, dc);
+    for (int i = 0; i < SQUARE_PER_SHAPE; ++i) {
+        cdnt[i].x += dr;
+        cdnt[i].y += dc;
+    }
+}
+
+int TetrisShape::distance(int dr, int dc) {
+    // Each cell finds the first filled cell of its column or row with one
+    // bit scan of the occupancy maps; the piece stops at the closest one
+    int best = std::max(TOTAL_ROWS, TOTAL_COLS);
+    for (int i = 0; i < SQUARE_PER_SHAPE; ++i) {
+        int x = cdnt[i].x;
+        int y = cdnt[i].y;
+        int free = dr != 0 ? free_cells(board_col_bits[y], x, dr, TOTAL_ROWS)
+                           : free_cells(board_row_bits[x], y, dc, TOTAL_COLS);
+        best = std::min(best, free);
     }
+    return best;
 }
\ No newline at end of file
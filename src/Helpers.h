@@ -1,11 +1,14 @@
 #ifndef SHADER_H
 #define SHADER_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <Eigen/Core>
 #include <Eigen/Dense>
 
+#include "Shapes.h"
+
 #define GL_SILENCE_DEPRECATION
 
 #include <chrono>
@@ -23,7 +26,9 @@
 #  undef DrawText
 #endif
 
-#ifndef __APPLE__
+#if defined(TETRIS_GL_LOADER)
+#  include "gl_loader.h"
+#elif !defined(__APPLE__)
 #  define GLEW_STATIC
 #  include <GL/glew.h>
 #endif
@@ -102,7 +107,24 @@ public:
     GLuint rows;
     GLuint cols;
 
-    VertexBufferObject() : id(0), rows(0), cols(0) {}
+    // Multi-buffered streaming: the buffer is split into region_count
+    // regions of rows x cols floats. Each frame writes the next region while
+    // the GPU may still be reading the others, and a fence per region keeps
+    // a region from being rewritten before the draws reading it are done.
+    static const int MAX_REGIONS = 4;
+    GLuint region_count;
+    GLuint region;
+    GLsync fences[MAX_REGIONS];
+    // How often mapping a region had to block on its fence, and for how long
+    long long int region_maps;
+    long long int region_waits;
+    double region_wait_ms;
+
+    VertexBufferObject() : id(0), rows(0), cols(0), region_count(0), region(0),
+                           region_maps(0), region_waits(0), region_wait_ms(0.) {
+      for (int i = 0; i < MAX_REGIONS; ++i)
+        fences[i] = 0;
+    }
 
     // Create a new empty VBO
     void init();
@@ -110,6 +132,31 @@ public:
     // Updates the VBO with a matrix M
     void update(const Eigen::MatrixXf& M);
 
+    // Streams the first n columns of M into fresh storage, so the GPU never
+    // has to finish with the old contents before we can write
+    void stream(const Eigen::MatrixXf& M, GLuint n);
+
+    // Allocates count regions, each holding a rows x cols matrix
+    void init_regions(GLuint count, GLuint r, GLuint c);
+
+    // Moves to the next region, waits until the GPU is done with it and
+    // maps it for writing; unmap_region() must follow before drawing
+    float* map_region();
+    void unmap_region();
+
+    // Copies the first n columns of M into the next region
+    void write_region(const Eigen::MatrixXf& M, GLuint n);
+
+    // First float and first column of the current region
+    GLuint region_offset() const { return region * rows * cols; }
+    GLuint region_first() const { return region * cols; }
+
+    // Fences the current region, call after the last draw reading from it
+    void fence_region();
+    // Same, for a region drawn again without being rewritten: the fence of
+    // its earlier draws is replaced, since the new one completes after them
+    void refence_region();
+
     // Select this VBO for subsequent draw calls
     void bind();
 
@@ -117,6 +164,30 @@ public:
     void free();
 };
 
+class Texture
+{
+public:
+    typedef unsigned int GLuint;
+
+    GLuint id;
+    GLuint width;
+    GLuint height;
+
+    Texture() : id(0), width(0), height(0) {}
+
+    // Create a new empty texture
+    void init();
+
+    // Uploads a single channel 8 bit image, sampled without filtering
+    void update(GLuint w, GLuint h, const unsigned char* pixels);
+
+    // Select this texture on texture unit 0
+    void bind();
+
+    // Release the id
+    void free();
+};
+
 // This class wraps an OpenGL program composed of two shaders
 class Program
 {
@@ -150,6 +221,10 @@ public:
   // Bind a per-vertex array attribute
   GLint bindVertexAttribArray(const std::string &name, VertexBufferObject& VBO) const;
 
+  // Bind size floats starting at row offset of each column of an interleaved VBO
+  GLint bindVertexAttribArray(const std::string &name, VertexBufferObject& VBO,
+                              GLint size, GLuint offset) const;
+
   GLuint create_shader_helper(GLint type, const std::string &shader_string);
 
 };
@@ -203,71 +278,26 @@ public:
         is_visible = is_vis;
     }
 
+    // Builds V and C; needs no GL context, so it can run during window
+    // creation. init() calls it if it has not run.
+    static void prepare();
     static void init();
     static void teardown();
     void render();
+    // Renders shifted by (dx, dy) without moving the rect
+    void render_offset(float dx, float dy);
     void scale(float fac);
     void translate(float dist_x, float dist_y);
 };
 
-enum SHAPE_TYPE {
-    TETRIS_LSHAPE,
-    TETRIS_GAMMASHAPE,
-    TETRIS_STRIPSHAPE,
-    TETRIS_TSHAPE,
-    TETRIS_SQUARESHAPE,
-    TETRIS_LEFTNSHAPE,
-    TETRIS_RIGHTNSHAPE,
-    TETRIS_TOTALSHAPE
-};
-
-enum SHAPE_SUBTYPE {
-    LSHAPE_DOWN,
-    LSHAPE_LEFT,
-    LSHAPE_UP,
-    LSHAPE_RIGHT,
-    GAMMASHAPE_DOWN,
-    GAMMASHAPE_RIGHT,
-    GAMMASHAPE_UP,
-    GAMMASHAPE_LEFT,
-    STRIPSHAPE_LANDSCAPE,
-    STRIPSHAPE_PORTRAIT,
-    TSHAPE_DOWN,
-    TSHAPE_LEFT,
-    TSHAPE_UP,
-    TSHAPE_RIGHT,
-    LEFTNSHAPE_VERTICAL,
-    LEFTNSHAPE_HORIZONTAL,
-    RIGHTNSHAPE_VERTICAL,
-    RIGHTNSHAPE_HORIZONTAL
-};
-
-struct coordinate {
-    int x;
-    int y;
-    coordinate(): x(0), y(0) {}
-    coordinate(int _x, int _y): x(_x), y(_y) {}
-
-    void move_down() {
-        ++x;
-    }
-
-    void move_left() {
-        --y;
-    }
-
-    void move_right() {
-        ++y;
-    }
-};
-
-const GLuint SQUARE_PER_SHAPE = 4;
 
 class TetrisShape {
 public:
     SHAPE_TYPE stype;
     SHAPE_SUBTYPE shsubtype;
     coordinate cdnt[SQUARE_PER_SHAPE];
+    // Zobrist::piece() of the cells, updated by every move and rotation
+    uint64_t hash;
     TetrisShape(SHAPE_TYPE t);
 
     int leftmost();
@@ -286,6 +316,14 @@ public:
 
     void move_to_bottom();
 
+    // Moves every cell by the same offset, without checking the board
+    void shift(int dr, int dc);
+
+    // Free cells between the piece and the board or a wall when moving
+    // in direction (dr, dc), one of the four unit steps, for instant slides
+    // and drops
+    int distance(int dr, int dc);
+
     bool can_move_left();
 
     bool can_move_right();
@@ -0,0 +1,114 @@
+#include "Histogram.h"
+
+Histogram::Histogram(const char* name) : label(name) {
+    reset();
+}
+
+int Histogram::bucket_of(uint64_t us) {
+    int msb = 0;
+    for (uint64_t v = us >> 1; v != 0; v >>= 1) {
+        ++msb;
+    }
+    int shift = msb > SUB_BITS ? msb - SUB_BITS : 0;
+    if (shift > MAX_SHIFT) {
+        return BUCKETS - 1;
+    }
+    return shift * SUB_BUCKETS + (int)(us >> shift);
+}
+
+uint64_t Histogram::bucket_lower(int bucket) {
+    if (bucket < 2 * SUB_BUCKETS) {
+        return bucket;
+    }
+    int shift = bucket / SUB_BUCKETS - 1;
+    return (uint64_t)(bucket - shift * SUB_BUCKETS) << shift;
+}
+
+// Only the recording thread writes, so a plain load and store is enough
+void Histogram::bump(std::atomic<uint64_t>& value, uint64_t by) {
+    value.store(value.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+}
+
+void Histogram::record(double ms) {
+    uint64_t us = ms > 0. ? (uint64_t)(ms * 1000.0 + 0.5) : 0;
+    bump(counts[bucket_of(us)], 1);
+    bump(total, 1);
+    bump(sum_us, us);
+    if (us > largest_us.load(std::memory_order_relaxed)) {
+        largest_us.store(us, std::memory_order_relaxed);
+    }
+}
+
+void Histogram::reset() {
+    for (int b = 0; b < BUCKETS; ++b) {
+        counts[b].store(0, std::memory_order_relaxed);
+    }
+    total.store(0, std::memory_order_relaxed);
+    sum_us.store(0, std::memory_order_relaxed);
+    largest_us.store(0, std::memory_order_relaxed);
+}
+
+long long int Histogram::count() const {
+    return (long long int)total.load(std::memory_order_relaxed);
+}
+
+double Histogram::mean_ms() const {
+    uint64_t n = total.load(std::memory_order_relaxed);
+    return n > 0 ? sum_us.load(std::memory_order_relaxed) / 1000.0 / n : 0.;
+}
+
+double Histogram::max_ms() const {
+    return largest_us.load(std::memory_order_relaxed) / 1000.0;
+}
+
+double Histogram::percentile_ms(double q) const {
+    uint64_t n = total.load(std::memory_order_relaxed);
+    if (n == 0) {
+        return 0.;
+    }
+    uint64_t rank = (uint64_t)(q * n + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int b = 0; b < BUCKETS; ++b) {
+        seen += counts[b].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            // Never report more than the largest value actually recorded
+            uint64_t upper = b + 1 < BUCKETS ? bucket_lower(b + 1) : bucket_lower(b);
+            uint64_t largest = largest_us.load(std::memory_order_relaxed);
+            return (upper < largest ? upper : largest) / 1000.0;
+        }
+    }
+    return max_ms();
+}
+
+void Histogram::write_json(FILE* out) const {
+    fprintf(out, "{\"count\": %lld, \"mean_ms\": %.3f, \"p50_ms\": %.3f, \"p90_ms\": %.3f, "
+                 "\"p99_ms\": %.3f, \"max_ms\": %.3f, \"buckets\": [",
+            count(), mean_ms(), percentile_ms(0.5), percentile_ms(0.9),
+            percentile_ms(0.99), max_ms());
+    bool first = true;
+    for (int b = 0; b < BUCKETS; ++b) {
+        uint64_t n = counts[b].load(std::memory_order_relaxed);
+        if (n == 0) {
+            continue;
+        }
+        fprintf(out, "%s[%.3f, %llu]", first ? "" : ", ", bucket_lower(b) / 1000.0,
+                (unsigned long long int)n);
+        first = false;
+    }
+    fprintf(out, "]}");
+}
+
+void Histogram::write_csv(FILE* out) const {
+    for (int b = 0; b < BUCKETS; ++b) {
+        uint64_t n = counts[b].load(std::memory_order_relaxed);
+        if (n == 0) {
+            continue;
+        }
+        uint64_t upper = b + 1 < BUCKETS ? bucket_lower(b + 1) : bucket_lower(b);
+        fprintf(out, "%s,%.3f,%.3f,%llu\n", label, bucket_lower(b) / 1000.0,
+                upper / 1000.0, (unsigned long long int)n);
+    }
+}
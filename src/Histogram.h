@@ -0,0 +1,53 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+// Fixed-size latency histogram with log-linear buckets, in the style of
+// HdrHistogram: values are kept in microseconds, exactly below 64 us and
+// with SUB_BUCKETS steps per power of two above, so every bucket is within
+// about 3% of the values in it. Recording is a few integer operations and
+// never allocates. One thread records; any thread may read, and sees each
+// bucket either before or after a concurrent record.
+class Histogram {
+public:
+    static const int SUB_BITS = 5;
+    static const int SUB_BUCKETS = 1 << SUB_BITS;
+    // Covers up to 2^(MAX_SHIFT + SUB_BITS + 1) us, a little over a minute
+    static const int MAX_SHIFT = 20;
+    static const int BUCKETS = (MAX_SHIFT + 2) * SUB_BUCKETS;
+
+    explicit Histogram(const char* name);
+
+    void record(double ms);
+    // Only while nothing is recording
+    void reset();
+
+    const char* name() const { return label; }
+    long long int count() const;
+    double mean_ms() const;
+    double max_ms() const;
+    // Upper edge of the bucket holding the q-th quantile, 0 <= q <= 1
+    double percentile_ms(double q) const;
+
+    // One JSON object: summary and the non-empty buckets
+    void write_json(FILE* out) const;
+    // One name,lower_ms,upper_ms,count row per non-empty bucket
+    void write_csv(FILE* out) const;
+
+private:
+    static int bucket_of(uint64_t us);
+    static uint64_t bucket_lower(int bucket);
+
+    void bump(std::atomic<uint64_t>& value, uint64_t by);
+
+    const char* label;
+    std::atomic<uint64_t> counts[BUCKETS];
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> sum_us;
+    std::atomic<uint64_t> largest_us;
+};
+
+#endif
@@ -0,0 +1,374 @@
+#include "Hud.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+struct Glyph {
+    char ch;
+    unsigned char rows[Hud::GLYPH_H];
+};
+
+// Each row holds 5 pixels, most significant bit on the left
+const Glyph FONT[] = {
+    { '0', { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E } },
+    { '1', { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+    { '2', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F } },
+    { '3', { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E } },
+    { '4', { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 } },
+    { '5', { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E } },
+    { '6', { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E } },
+    { '7', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 } },
+    { '8', { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E } },
+    { '9', { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C } },
+    { 'A', { 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+    { 'B', { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E } },
+    { 'C', { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E } },
+    { 'D', { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C } },
+    { 'E', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F } },
+    { 'F', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 } },
+    { 'G', { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F } },
+    { 'H', { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+    { 'I', { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+    { 'J', { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C } },
+    { 'K', { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 } },
+    { 'L', { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F } },
+    { 'M', { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 } },
+    { 'N', { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 } },
+    { 'O', { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+    { 'P', { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 } },
+    { 'Q', { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D } },
+    { 'R', { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 } },
+    { 'S', { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E } },
+    { 'T', { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 } },
+    { 'U', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+    { 'V', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 } },
+    { 'W', { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A } },
+    { 'X', { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 } },
+    { 'Y', { 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04, 0x04 } },
+    { 'Z', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F } },
+    { ':', { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 } },
+    { '.', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C } },
+    { '/', { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 } },
+    { '-', { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 } },
+};
+
+const int FONT_SIZE = sizeof(FONT) / sizeof(FONT[0]);
+
+}
+
+void HudStats::copy_timing(const HudStats& other) {
+    frame_ms = other.frame_ms;
+    frame_avg_ms = other.frame_avg_ms;
+    frame_max_ms = other.frame_max_ms;
+    hud_ms = other.hud_ms;
+    gpu_clear_ms = other.gpu_clear_ms;
+    gpu_board_ms = other.gpu_board_ms;
+    gpu_particles_ms = other.gpu_particles_ms;
+    gpu_present_ms = other.gpu_present_ms;
+    gpu_hud_ms = other.gpu_hud_ms;
+}
+
+bool HudStats::same_display(const HudStats& other) const {
+    return score == other.score && lines == other.lines && level == other.level &&
+           drop_speed == other.drop_speed && frame_ms == other.frame_ms &&
+           frame_avg_ms == other.frame_avg_ms && frame_max_ms == other.frame_max_ms &&
+           hud_ms == other.hud_ms && gpu_clear_ms == other.gpu_clear_ms &&
+           gpu_board_ms == other.gpu_board_ms && gpu_particles_ms == other.gpu_particles_ms &&
+           gpu_present_ms == other.gpu_present_ms && gpu_hud_ms == other.gpu_hud_ms &&
+           strcmp(quality, other.quality) == 0 && quality_auto == other.quality_auto &&
+           next_type == other.next_type && paused == other.paused;
+}
+
+const GLchar* Hud::vertex_shader =
+            "#version 150 core\n"
+                    "in vec2 position;"
+                    "in vec2 texcoord;"
+                    "in vec4 color;"
+                    "out vec2 f_texcoord;"
+                    "out vec4 f_color;"
+                    "void main()"
+                    "{"
+                    "    gl_Position = vec4(position, 0.0, 1.0);"
+                    "    f_texcoord = texcoord;"
+                    "    f_color = color;"
+                    "}";
+
+const GLchar* Hud::fragment_shader =
+        "#version 150 core\n"
+                "in vec2 f_texcoord;"
+                "in vec4 f_color;"
+                "uniform sampler2D atlas;"
+                "out vec4 outColor;"
+                "void main()"
+                "{"
+                "    float coverage = texture(atlas, f_texcoord).r;"
+                "    outColor = vec4(f_color.rgb, f_color.a * coverage);"
+                "}";
+
+Program Hud::program;
+Texture Hud::atlas;
+VertexArrayObject Hud::VAO;
+VertexBufferObject Hud::VBO;
+
+int Hud::glyph_cell[128];
+int Hud::solid_cell = 0;
+
+Eigen::MatrixXf Hud::V;
+int Hud::quad_num = 0;
+HudStats Hud::drawn;
+bool Hud::drawn_valid = false;
+bool Hud::redrawn = false;
+std::vector<unsigned char> Hud::atlas_pixels;
+
+void Hud::prepare() {
+    const int width = ATLAS_COLS * CELL_SIZE;
+    const int height = ATLAS_ROWS * CELL_SIZE;
+    std::vector<unsigned char>& pixels = atlas_pixels;
+    pixels.assign(width * height, 0);
+
+    for (int c = 0; c < 128; ++c) {
+        glyph_cell[c] = -1;
+    }
+
+    // Cell 0 is fully covered and used for solid rectangles
+    solid_cell = 0;
+    for (int y = 0; y < CELL_SIZE; ++y) {
+        for (int x = 0; x < CELL_SIZE; ++x) {
+            pixels[y * width + x] = 255;
+        }
+    }
+
+    for (int g = 0; g < FONT_SIZE; ++g) {
+        int cell = g + 1;
+        int cx = (cell % ATLAS_COLS) * CELL_SIZE;
+        int cy = (cell / ATLAS_COLS) * CELL_SIZE;
+        for (int y = 0; y < GLYPH_H; ++y) {
+            for (int x = 0; x < GLYPH_W; ++x) {
+                if (FONT[g].rows[y] & (1 << (GLYPH_W - 1 - x))) {
+                    pixels[(cy + y) * width + cx + x] = 255;
+                }
+            }
+        }
+        glyph_cell[(int)FONT[g].ch] = cell;
+        if (FONT[g].ch >= 'A' && FONT[g].ch <= 'Z') {
+            glyph_cell[FONT[g].ch - 'A' + 'a'] = cell;
+        }
+    }
+
+    V.resize(VERTEX_FLOATS, 6 * MAX_QUADS);
+}
+
+void Hud::init() {
+    if (atlas_pixels.empty()) {
+        prepare();
+    }
+
+    program.init(vertex_shader, fragment_shader, "outColor");
+    program.bind();
+    glUniform1i(program.uniform("atlas"), 0);
+
+    atlas.init();
+    atlas.update(ATLAS_COLS * CELL_SIZE, ATLAS_ROWS * CELL_SIZE, atlas_pixels.data());
+
+    VAO.init();
+    VAO.bind();
+
+    VBO.init();
+    VBO.init_regions(FRAME_REGIONS, VERTEX_FLOATS, 6 * MAX_QUADS);
+
+    program.bindVertexAttribArray("position", VBO, 2, 0);
+    program.bindVertexAttribArray("texcoord", VBO, 2, 2);
+    program.bindVertexAttribArray("color", VBO, 4, 4);
+}
+
+void Hud::teardown() {
+    program.free();
+    atlas.free();
+    VAO.free();
+    VBO.free();
+    drawn_valid = false;
+    redrawn = false;
+}
+
+void Hud::begin() {
+    quad_num = 0;
+    drawn_valid = false;
+}
+
+void Hud::quad(float x0, float y0, float x1, float y1,
+               float u0, float v0, float u1, float v1,
+               float r, float g, float b, float a) {
+    if (quad_num >= MAX_QUADS) {
+        return;
+    }
+
+    // Two triangles, y0 is the top edge
+    const float corners[6][4] = {
+        {x0, y0, u0, v0}, {x0, y1, u0, v1}, {x1, y1, u1, v1},
+        {x0, y0, u0, v0}, {x1, y1, u1, v1}, {x1, y0, u1, v0}
+    };
+    float* dst = V.data() + quad_num * 6 * VERTEX_FLOATS;
+    for (int k = 0; k < 6; ++k) {
+        dst[0] = corners[k][0];
+        dst[1] = corners[k][1];
+        dst[2] = corners[k][2];
+        dst[3] = corners[k][3];
+        dst[4] = r;
+        dst[5] = g;
+        dst[6] = b;
+        dst[7] = a;
+        dst += VERTEX_FLOATS;
+    }
+    ++quad_num;
+}
+
+void Hud::text(float x, float y, float px, const char* str,
+               float r, float g, float b, float a) {
+    const float atlas_w = (float)(ATLAS_COLS * CELL_SIZE);
+    const float atlas_h = (float)(ATLAS_ROWS * CELL_SIZE);
+    float pen = x;
+
+    for (const char* p = str; *p; ++p) {
+        int ch = (unsigned char)*p;
+        int cell = ch < 128 ? glyph_cell[ch] : -1;
+        if (cell >= 0) {
+            float u0 = (cell % ATLAS_COLS) * CELL_SIZE / atlas_w;
+            float v0 = (cell / ATLAS_COLS) * CELL_SIZE / atlas_h;
+            quad(pen, y, pen + GLYPH_W * px, y - GLYPH_H * px,
+                 u0, v0, u0 + GLYPH_W / atlas_w, v0 + GLYPH_H / atlas_h,
+                 r, g, b, a);
+        }
+        pen += (GLYPH_W + 1) * px;
+    }
+}
+
+void Hud::rect(float x, float y, float w, float h,
+               float r, float g, float b, float a) {
+    const float atlas_w = (float)(ATLAS_COLS * CELL_SIZE);
+    const float atlas_h = (float)(ATLAS_ROWS * CELL_SIZE);
+    // Sample well inside the solid cell so filtering never reaches a neighbour
+    float u = (solid_cell % ATLAS_COLS + 0.5f) * CELL_SIZE / atlas_w;
+    float v = (solid_cell / ATLAS_COLS + 0.5f) * CELL_SIZE / atlas_h;
+    quad(x, y, x + w, y - h, u, v, u, v, r, g, b, a);
+}
+
+void Hud::draw() {
+    VAO.bind();
+    program.bind();
+    atlas.bind();
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDrawArrays(GL_TRIANGLES, VBO.region_first(), quad_num * 6);
+    glDisable(GL_BLEND);
+}
+
+void Hud::end() {
+    if (quad_num == 0) {
+        return;
+    }
+
+    // Fence the draws made from the region since it was written, so it is
+    // not rewritten under them once the regions come around to it again
+    if (redrawn) {
+        VBO.refence_region();
+        redrawn = false;
+    }
+    VBO.write_region(V, quad_num * 6);
+    draw();
+    VBO.fence_region();
+}
+
+void Hud::render(const HudStats& stats) {
+    const float px = 0.005f;
+    const float line = (GLYPH_H + 3) * px;
+    char buf[64];
+
+    // Most frames show the same numbers as the last one: skip the layout and
+    // the upload, and draw the region written back then once more. Its fence
+    // is only renewed when the HUD next changes, as a fence flushes the GPU.
+    if (drawn_valid && stats.same_display(drawn)) {
+        if (quad_num > 0) {
+            draw();
+            redrawn = true;
+        }
+        return;
+    }
+
+    begin();
+
+    // Translucent panel so the text stays readable over the board
+    rect(-1.f, 1.f, 0.7f, 12 * line + 2 * px, 0.f, 0.f, 0.f, 0.5f);
+
+    float x = -1.f + 3 * px;
+    float y = 1.f - 3 * px;
+    snprintf(buf, sizeof(buf), "SCORE %lld", stats.score);
+    text(x, y, px, buf, 1.f, 1.f, 1.f, 1.f);
+    y -= line;
+    snprintf(buf, sizeof(buf), "LEVEL %d", stats.level);
+    text(x, y, px, buf, 1.f, 1.f, 1.f, 1.f);
+    y -= line;
+    snprintf(buf, sizeof(buf), "LINES %lld", stats.lines);
+    text(x, y, px, buf, 1.f, 1.f, 1.f, 1.f);
+    y -= line;
+    snprintf(buf, sizeof(buf), "SPEED %.1f/S", stats.drop_speed);
+    text(x, y, px, buf, 1.f, 1.f, 1.f, 1.f);
+    y -= line;
+    snprintf(buf, sizeof(buf), "CPU %.2f MS", stats.frame_ms);
+    text(x, y, px, buf, 1.f, 1.f, 0.f, 1.f);
+    y -= line;
+    snprintf(buf, sizeof(buf), "AVG %.2f MAX %.2f", stats.frame_avg_ms, stats.frame_max_ms);
+    text(x, y, px, buf, 1.f, 1.f, 0.f, 1.f);
+    y -= line;
+    snprintf(buf, sizeof(buf), "HUD %.3f MS", stats.hud_ms);
+    text(x, y, px, buf, 1.f, 1.f, 0.f, 1.f);
+    y -= line;
+    snprintf(buf, sizeof(buf), "QUALITY %s%s", stats.quality,
+             stats.quality_auto ? " AUTO" : "");
+    text(x, y, px, buf, 1.f, 1.f, 0.f, 1.f);
+    y -= line;
+    if (stats.gpu_clear_ms < 0.) {
+        text(x, y, px, "GPU N/A", 0.f, 1.f, 1.f, 1.f);
+    } else {
+        snprintf(buf, sizeof(buf), "GPU CLR %.2f BRD %.2f",
+                 stats.gpu_clear_ms, stats.gpu_board_ms);
+        text(x, y, px, buf, 0.f, 1.f, 1.f, 1.f);
+        y -= line;
+        snprintf(buf, sizeof(buf), "GPU PRT %.2f RES %.2f",
+                 stats.gpu_particles_ms, stats.gpu_present_ms);
+        text(x, y, px, buf, 0.f, 1.f, 1.f, 1.f);
+        y -= line;
+        snprintf(buf, sizeof(buf), "GPU HUD %.2f", stats.gpu_hud_ms);
+        text(x, y, px, buf, 0.f, 1.f, 1.f, 1.f);
+    }
+
+    // Centered banner, glyphs four times the normal size
+    if (stats.paused) {
+        const float big = 4 * px;
+        rect(-0.42f, 0.13f, 0.84f, 0.26f, 0.f, 0.f, 0.f, 0.7f);
+        text(-0.35f, 0.07f, big, "PAUSED", 1.f, 1.f, 1.f, 1.f);
+    }
+
+    // Next piece preview in the top right corner
+    if (stats.next_type != TETRIS_TOTALSHAPE) {
+        TetrisShape next(stats.next_type);
+        const float cell = 0.05f;
+        float px0 = 1.f - 6 * cell;
+        float py0 = 1.f;
+        rect(px0, py0, 6 * cell, 5 * cell, 0.f, 0.f, 0.f, 0.5f);
+        text(px0 + 3 * px, py0 - 3 * px, px, "NEXT", 1.f, 1.f, 1.f, 1.f);
+
+        int top = next.upmost();
+        int left = next.leftmost();
+        for (int i = 0; i < SQUARE_PER_SHAPE; ++i) {
+            float sx = px0 + cell + (next.cdnt[i].y - left) * cell;
+            float sy = py0 - 2 * cell - (next.cdnt[i].x - top) * cell;
+            rect(sx, sy, cell * 0.9f, cell * 0.9f, 0.2f, 0.8f, 1.f, 1.f);
+        }
+    }
+
+    end();
+    drawn = stats;
+    drawn_valid = true;
+}
@@ -0,0 +1,106 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include "Helpers.h"
+
+// Everything the HUD shows, filled in by the game loop once per frame
+struct HudStats {
+    long long int score;
+    long long int lines;
+    int level;
+    double drop_speed;
+    double frame_ms;
+    double frame_avg_ms;
+    double frame_max_ms;
+    double hud_ms;
+    // GPU time of each pass, averaged; negative when it can not be measured
+    double gpu_clear_ms;
+    double gpu_board_ms;
+    double gpu_particles_ms;
+    double gpu_present_ms;
+    double gpu_hud_ms;
+    // Render quality profile and whether it is picked automatically
+    const char* quality;
+    bool quality_auto;
+    SHAPE_TYPE next_type;
+    bool paused;
+
+    HudStats(): score(0), lines(0), level(0), drop_speed(0.),
+                frame_ms(0.), frame_avg_ms(0.), frame_max_ms(0.),
+                hud_ms(0.), gpu_clear_ms(-1.), gpu_board_ms(-1.),
+                gpu_particles_ms(-1.), gpu_present_ms(-1.), gpu_hud_ms(-1.),
+                quality(""), quality_auto(false), next_type(TETRIS_TOTALSHAPE),
+                paused(false) {}
+
+    // Takes the frame and GPU timings of other, leaving the game state
+    void copy_timing(const HudStats& other);
+    // Whether both lay out to the same HUD
+    bool same_display(const HudStats& other) const;
+};
+
+// Text and the next piece preview drawn on top of the board.
+// Glyphs come from a single atlas texture; every quad of a frame is
+// written into one streaming VBO and drawn with a single glDrawArrays.
+class Hud {
+public:
+    // 5x7 glyphs, stored in 8x8 cells of the atlas
+    static const int GLYPH_W = 5;
+    static const int GLYPH_H = 7;
+    static const int CELL_SIZE = 8;
+    static const int ATLAS_COLS = 16;
+    static const int ATLAS_ROWS = 8;
+    // Vertex layout: x, y, u, v, r, g, b, a
+    static const int VERTEX_FLOATS = 8;
+    static const int MAX_QUADS = 1024;
+    // Frames of vertex data the GPU may still be reading while we write
+    static const int FRAME_REGIONS = 3;
+
+    static const GLchar* vertex_shader;
+    static const GLchar* fragment_shader;
+    static Program program;
+    static Texture atlas;
+    static VertexArrayObject VAO;
+    static VertexBufferObject VBO;
+
+    // Atlas cell of every ASCII character, -1 when there is no glyph
+    static int glyph_cell[128];
+    static int solid_cell;
+
+    // CPU side copy of the quads of the current frame
+    static Eigen::MatrixXf V;
+    static int quad_num;
+    // What the quads in the current region were laid out from; render()
+    // draws them again as they are when nothing shown has changed
+    static HudStats drawn;
+    static bool drawn_valid;
+    // Drawn again since the fence of the current region was set
+    static bool redrawn;
+
+    // Atlas image, built by prepare() and uploaded by init()
+    static std::vector<unsigned char> atlas_pixels;
+
+    // Builds the atlas and the vertex storage; needs no GL context, so it
+    // can run during window creation. init() calls it if it has not run.
+    static void prepare();
+    static void init();
+    static void teardown();
+
+    // Lays out the whole HUD from the stats and draws it
+    static void render(const HudStats& stats);
+
+    // Low level layout, positions in normalized device coordinates
+    static void begin();
+    static void text(float x, float y, float px, const char* str,
+                     float r, float g, float b, float a);
+    static void rect(float x, float y, float w, float h,
+                     float r, float g, float b, float a);
+    static void end();
+
+private:
+    static void draw();
+    static void quad(float x0, float y0, float x1, float y1,
+                     float u0, float v0, float u1, float v1,
+                     float r, float g, float b, float a);
+};
+
+#endif
@@ -0,0 +1,395 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#  include <pthread.h>
+#  include <sched.h>
+#endif
+#ifdef _MSC_VER
+#  include <malloc.h>
+#endif
+
+namespace {
+
+// The job of TaskGroup::run(work), which holds a copy of work
+struct FunctionJob : JobSystem::Job {
+    std::function<void()> work;
+};
+
+void call_function(void* work) {
+    (*static_cast<std::function<void()>*>(work))();
+}
+
+typedef JobSystem::Job* JobPtr;
+
+// Chase-Lev deque in the C11 formulation of Le, Pop, Cohen and Nardelli.
+// The owner pushes and pops at bottom, thieves take from top, and only a
+// pop racing a steal for the last job needs a compare-and-swap.
+class WorkDeque {
+public:
+    static const int64_t CAPACITY = 4096;
+
+    WorkDeque() : executed(0), stolen(0), top(0), bottom(0) {}
+
+    // Owner only; false when full
+    bool push(JobPtr job) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t >= CAPACITY) {
+            return false;
+        }
+        jobs[b % CAPACITY].store(job, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Owner only, newest first
+    JobPtr pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return NULL;
+        }
+        JobPtr job = jobs[b % CAPACITY].load(std::memory_order_relaxed);
+        if (t == b) {
+            // Last job, a thief may be taking it too
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                             std::memory_order_relaxed)) {
+                job = NULL;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    // Any thread, oldest first; NULL when empty or when another thief won
+    JobPtr steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return NULL;
+        }
+        JobPtr job = jobs[t % CAPACITY].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                         std::memory_order_relaxed)) {
+            return NULL;
+        }
+        return job;
+    }
+
+    // Counted by the owner only
+    std::atomic<long long int> executed;
+    std::atomic<long long int> stolen;
+
+private:
+    // Thieves and the owner sit on separate cache lines
+    alignas(64) std::atomic<int64_t> top;
+    alignas(64) std::atomic<int64_t> bottom;
+    std::atomic<JobPtr> jobs[CAPACITY];
+};
+
+// new does not align to a cache line before C++17
+WorkDeque* new_deque() {
+    void* memory = NULL;
+#ifdef _MSC_VER
+    memory = _aligned_malloc(sizeof(WorkDeque), alignof(WorkDeque));
+#else
+    if (posix_memalign(&memory, alignof(WorkDeque), sizeof(WorkDeque)) != 0) {
+        memory = NULL;
+    }
+#endif
+    if (memory == NULL) {
+        throw std::bad_alloc();
+    }
+    return new (memory) WorkDeque();
+}
+
+void delete_deque(WorkDeque* deque) {
+    deque->~WorkDeque();
+#ifdef _MSC_VER
+    _aligned_free(deque);
+#else
+    free(deque);
+#endif
+}
+
+// First in, first out under a lock; grows only when full, so it stops
+// allocating once it has held the most jobs it will
+class SharedQueue {
+public:
+    SharedQueue() : jobs(64), head(0), size(0) {}
+
+    void push(JobPtr job) {
+        if (size == jobs.size()) {
+            std::vector<JobPtr> bigger(2 * jobs.size());
+            for (size_t i = 0; i < size; ++i) {
+                bigger[i] = jobs[(head + i) % jobs.size()];
+            }
+            jobs.swap(bigger);
+            head = 0;
+        }
+        jobs[(head + size) % jobs.size()] = job;
+        ++size;
+    }
+
+    JobPtr pop() {
+        if (size == 0) {
+            return NULL;
+        }
+        JobPtr job = jobs[head];
+        head = (head + 1) % jobs.size();
+        --size;
+        return job;
+    }
+
+private:
+    std::vector<JobPtr> jobs;
+    size_t head;
+    size_t size;
+};
+
+// Worker 0 is left to threads outside the pool, which have no deque
+std::vector<WorkDeque*> deques;
+std::vector<std::thread> threads;
+thread_local int worker_index = -1;
+thread_local uint32_t steal_seed = 0;
+
+// Jobs of threads outside the pool
+std::mutex shared_mutex;
+SharedQueue shared_jobs;
+std::atomic<long long int> shared_executed(0);
+
+// Queued jobs nobody has taken yet, for idle workers to sleep on
+std::atomic<int> pending(0);
+std::atomic<int> sleepers(0);
+std::mutex sleep_mutex;
+std::condition_variable wake;
+std::atomic<bool> running(false);
+
+// Rounds a worker looks for jobs before it goes to sleep
+const int SPIN_ROUNDS = 64;
+
+void pin_to_core(int core) {
+#ifdef __linux__
+    int cores = (int)std::thread::hardware_concurrency();
+    if (cores <= 0) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % cores, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)core;
+#endif
+}
+
+}
+
+void JobSystem::init(int workers, bool pin) {
+    if (running.load()) {
+        return;
+    }
+    if (workers <= 0) {
+        workers = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+    running.store(true);
+    for (int i = 1; i < workers; ++i) {
+        deques.push_back(new_deque());
+    }
+    for (int i = 1; i < workers; ++i) {
+        threads.push_back(std::thread(worker_main, i, pin));
+    }
+}
+
+void JobSystem::shutdown() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        wake.notify_all();
+    }
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+    threads.clear();
+    for (size_t i = 0; i < deques.size(); ++i) {
+        delete_deque(deques[i]);
+    }
+    deques.clear();
+    shared_executed.store(0);
+}
+
+int JobSystem::worker_count() {
+    return (int)threads.size() + 1;
+}
+
+long long int JobSystem::executed_jobs() {
+    long long int total = shared_executed.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < deques.size(); ++i) {
+        total += deques[i]->executed.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+long long int JobSystem::stolen_jobs() {
+    long long int total = 0;
+    for (size_t i = 0; i < deques.size(); ++i) {
+        total += deques[i]->stolen.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void JobSystem::submit(Job* job) {
+    // Pairs with the sleepers increment in worker_main: either the worker
+    // sees this job or this sees the sleeper
+    pending.fetch_add(1);
+    if (worker_index <= 0 || !deques[worker_index - 1]->push(job)) {
+        std::lock_guard<std::mutex> lock(shared_mutex);
+        shared_jobs.push(job);
+    }
+    if (sleepers.load() > 0) {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        wake.notify_one();
+    }
+}
+
+bool JobSystem::run_one() {
+    WorkDeque* own = worker_index > 0 ? deques[worker_index - 1] : NULL;
+    Job* job = own != NULL ? own->pop() : NULL;
+    bool was_stolen = false;
+    if (job == NULL && pending.load(std::memory_order_relaxed) > 0) {
+        {
+            std::lock_guard<std::mutex> lock(shared_mutex);
+            job = shared_jobs.pop();
+        }
+        // Start at a random victim so thieves spread out
+        int count = (int)deques.size();
+        if (steal_seed == 0) {
+            steal_seed = 2654435761u * (uint32_t)(worker_index + 2);
+        }
+        steal_seed ^= steal_seed << 13;
+        steal_seed ^= steal_seed >> 17;
+        steal_seed ^= steal_seed << 5;
+        for (int i = 0; job == NULL && i < count; ++i) {
+            WorkDeque* victim = deques[(steal_seed + i) % count];
+            if (victim != own) {
+                job = victim->steal();
+                was_stolen = job != NULL;
+            }
+        }
+    }
+    if (job == NULL) {
+        return false;
+    }
+    pending.fetch_sub(1, std::memory_order_relaxed);
+    if (own != NULL) {
+        own->executed.fetch_add(1, std::memory_order_relaxed);
+        if (was_stolen) {
+            own->stolen.fetch_add(1, std::memory_order_relaxed);
+        }
+    } else {
+        shared_executed.fetch_add(1, std::memory_order_relaxed);
+    }
+    execute(job);
+    return true;
+}
+
+void JobSystem::execute(Job* job) {
+    job->function(job->data);
+    // A caller's job may be reused as soon as the group sees it finish
+    TaskGroup* group = job->group;
+    if (job->owned) {
+        delete static_cast<FunctionJob*>(job);
+    }
+    group->unfinished.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::worker_main(int index, bool pin) {
+    worker_index = index;
+    if (pin) {
+        pin_to_core(index);
+    }
+    int idle = 0;
+    for (;;) {
+        if (run_one()) {
+            idle = 0;
+            continue;
+        }
+        if (!running.load() && pending.load() == 0) {
+            return;
+        }
+        if (++idle < SPIN_ROUNDS) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        sleepers.fetch_add(1);
+        while (pending.load() == 0 && running.load()) {
+            wake.wait(lock);
+        }
+        sleepers.fetch_sub(1);
+        idle = 0;
+    }
+}
+
+void JobSystem::TaskGroup::run(const std::function<void()>& work) {
+    FunctionJob* job = new FunctionJob();
+    job->work = work;
+    job->owned = true;
+    run(job, call_function, &job->work);
+}
+
+void JobSystem::TaskGroup::run(Job* job, void (*function)(void* data), void* data) {
+    job->function = function;
+    job->data = data;
+    job->group = this;
+    unfinished.fetch_add(1, std::memory_order_relaxed);
+    submit(job);
+}
+
+void JobSystem::TaskGroup::wait() {
+    while (unfinished.load(std::memory_order_acquire) > 0) {
+        if (!run_one()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+namespace {
+
+void split_range(int lo, int hi, int grain, const std::function<void(int, int)>& body,
+                 JobSystem::TaskGroup& group) {
+    // Hand off the upper half and keep going on the lower one
+    while (hi - lo > grain) {
+        int mid = lo + (hi - lo) / 2;
+        group.run([mid, hi, grain, &body, &group] { split_range(mid, hi, grain, body, group); });
+        hi = mid;
+    }
+    body(lo, hi);
+}
+
+}
+
+void JobSystem::parallel_for(int begin, int end, int grain,
+                             const std::function<void(int, int)>& body) {
+    if (begin >= end) {
+        return;
+    }
+    TaskGroup group;
+    split_range(begin, end, std::max(grain, 1), body, group);
+    group.wait();
+}
@@ -0,0 +1,90 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Work-stealing thread pool shared by everything that wants more than one
+// core. Each worker owns a deque: it pushes and pops its own jobs at the
+// bottom while idle workers steal the oldest ones from the top, so forked
+// work stays on the core that made it until someone has nothing to do.
+// Threads outside the pool hand their jobs to a shared queue instead.
+//
+//   JobSystem::TaskGroup group;
+//   group.run([&] { left = search(a); });
+//   right = search(b);
+//   group.wait();
+//
+//   JobSystem::parallel_for(0, boards, 64, [&](int lo, int hi) { ... });
+//
+// run(work) allocates its job. Searches that must not allocate once warm
+// keep Jobs of their own and use run(job, function, data) instead.
+//
+// Without init() there are no workers and every job runs on the thread
+// that waits for it, so callers need no special case for one core.
+class JobSystem {
+public:
+    // Starts workers - 1 threads, the thread waiting on a group being the
+    // last one; 0 uses one per hardware thread. With pin each worker is
+    // kept on its own core, where the platform allows it.
+    static void init(int workers = 0, bool pin = false);
+    // Finishes the queued jobs and stops the threads
+    static void shutdown();
+
+    // Threads that run jobs, the waiting thread included
+    static int worker_count();
+
+    class TaskGroup;
+
+    // A queued call of function(data)
+    struct Job {
+        Job() : function(NULL), data(NULL), group(NULL), owned(false) {}
+
+        void (*function)(void* data);
+        void* data;
+        TaskGroup* group;
+        // Made by TaskGroup::run(work), deleted once it has run
+        bool owned;
+    };
+
+    // Jobs that finish together. wait() runs jobs, its own or any other,
+    // until every job started by run() has finished.
+    class TaskGroup {
+    public:
+        TaskGroup() : unfinished(0) {}
+        ~TaskGroup() { wait(); }
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        void run(const std::function<void()>& work);
+        // Without allocating: job belongs to the caller and may be used
+        // again once wait() has returned
+        void run(Job* job, void (*function)(void* data), void* data);
+        void wait();
+
+    private:
+        friend class JobSystem;
+        std::atomic<int> unfinished;
+    };
+
+    // Calls body(lo, hi) on disjoint ranges covering [begin, end), none
+    // longer than grain, and returns when all of them have run. Ranges are
+    // split in halves so a thief takes the biggest piece left.
+    static void parallel_for(int begin, int end, int grain,
+                             const std::function<void(int, int)>& body);
+
+    // Jobs run and jobs taken from another worker's deque since init()
+    static long long int executed_jobs();
+    static long long int stolen_jobs();
+
+private:
+    static void submit(Job* job);
+    static bool run_one();
+    static void execute(Job* job);
+    static void worker_main(int index, bool pin);
+};
+
+#endif
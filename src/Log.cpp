@@ -0,0 +1,111 @@
+#include "Log.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <thread>
+
+namespace {
+
+struct Slot {
+    // Ring position this slot is ready for: pos when free for the writer
+    // of pos, pos + 1 once that message is complete
+    std::atomic<uint64_t> sequence;
+    int level;
+    char text[Log::MESSAGE_SIZE];
+};
+
+// Bounded multi-producer queue after Dmitry Vyukov's design, drained by
+// the writer thread alone
+Slot slots[Log::CAPACITY];
+std::atomic<uint64_t> enqueue_pos(0);
+uint64_t dequeue_pos = 0;
+
+std::atomic<bool> running(false);
+std::thread writer;
+
+const char* const LEVEL_NAMES[] = {"", "debug", "info", "warn", "error"};
+
+struct SlotInit {
+    SlotInit() {
+        for (int i = 0; i < Log::CAPACITY; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+} slot_init;
+
+// Writes every complete message, returns how many there were
+int drain() {
+    int written = 0;
+    for (;;) {
+        Slot& slot = slots[dequeue_pos % Log::CAPACITY];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeue_pos + 1) {
+            break;
+        }
+        fprintf(stdout, "[%s] %s\n", LEVEL_NAMES[slot.level], slot.text);
+        slot.sequence.store(dequeue_pos + Log::CAPACITY, std::memory_order_release);
+        ++dequeue_pos;
+        ++written;
+    }
+    if (written > 0) {
+        fflush(stdout);
+    }
+    return written;
+}
+
+void writer_main() {
+    while (running.load(std::memory_order_acquire)) {
+        if (drain() == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+    drain();
+}
+
+}
+
+std::atomic<long long int> Log::dropped(0);
+
+void Log::init() {
+    if (!running.exchange(true)) {
+        writer = std::thread(writer_main);
+    }
+}
+
+void Log::shutdown() {
+    if (running.exchange(false)) {
+        writer.join();
+    }
+    drain();
+    long long int lost = dropped.exchange(0);
+    if (lost > 0) {
+        fprintf(stdout, "[warn] %lld log messages dropped, the ring was full\n", lost);
+    }
+}
+
+void Log::write(int level, const char* format, ...) {
+    uint64_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+        slot = &slots[pos % CAPACITY];
+        int64_t ready = (int64_t)slot->sequence.load(std::memory_order_acquire) - (int64_t)pos;
+        if (ready == 0) {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (ready < 0) {
+            // Still holds a message from the previous lap
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->level = level;
+    va_list args;
+    va_start(args, format);
+    vsnprintf(slot->text, MESSAGE_SIZE, format, args);
+    va_end(args);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+}
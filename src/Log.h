@@ -0,0 +1,65 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <atomic>
+#include <cstdint>
+
+// Leveled logging that never waits on I/O. A call formats its message into
+// a slot of a lock-free ring and returns; a background thread writes the
+// ring to stdout. When the ring is full the message is dropped and counted
+// instead of blocking the caller. Calls below TETRIS_LOG_LEVEL compile to
+// nothing, arguments included.
+//
+//   LOG_DEBUG("can morph: %d", result);
+
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_WARN 3
+#define LOG_LEVEL_ERROR 4
+#define LOG_LEVEL_OFF 5
+
+#ifndef TETRIS_LOG_LEVEL
+#  define TETRIS_LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+class Log {
+public:
+    static const int CAPACITY = 256;
+    static const int MESSAGE_SIZE = 120;
+
+    // Starts the writer thread; messages logged before are kept until then
+    static void init();
+    // Writes what is left and stops the writer thread
+    static void shutdown();
+
+    static void write(int level, const char* format, ...)
+#if defined(__GNUC__)
+        __attribute__((format(printf, 2, 3)))
+#endif
+        ;
+
+    static std::atomic<long long int> dropped;
+};
+
+#if TETRIS_LOG_LEVEL <= LOG_LEVEL_DEBUG
+#  define LOG_DEBUG(...) Log::write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#  define LOG_DEBUG(...) do {} while (0)
+#endif
+#if TETRIS_LOG_LEVEL <= LOG_LEVEL_INFO
+#  define LOG_INFO(...) Log::write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#  define LOG_INFO(...) do {} while (0)
+#endif
+#if TETRIS_LOG_LEVEL <= LOG_LEVEL_WARN
+#  define LOG_WARN(...) Log::write(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#  define LOG_WARN(...) do {} while (0)
+#endif
+#if TETRIS_LOG_LEVEL <= LOG_LEVEL_ERROR
+#  define LOG_ERROR(...) Log::write(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#  define LOG_ERROR(...) do {} while (0)
+#endif
+
+#endif
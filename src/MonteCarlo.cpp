@@ -0,0 +1,402 @@
+#include "MonteCarlo.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+const int MonteCarloSearch::MAX_PIECES;
+
+namespace {
+
+enum NODE_STATE {
+    NODE_NEW,
+    NODE_EXPANDING,
+    NODE_EXPANDED,
+    // The piece can not spawn, the game is over
+    NODE_TERMINAL
+};
+
+// Rewards are summed in fixed point so they can be added atomically
+const long long int REWARD_ONE = 1 << 20;
+// Score difference from the root that is worth a reward of about 0.88
+const float REWARD_SCALE = 10.f;
+const float EXPLORATION = 0.35f;
+// Decision and chance nodes on the longest path walked down
+const int MAX_PATH = 256;
+
+// For the hard-drop policy: per piece and orientation the lowest cell
+// row of each column of the bounding box, -1 for columns it leaves empty
+struct DropShape {
+    int width;
+    int bottom[4];
+};
+
+struct DropTables {
+    DropShape shapes[TETRIS_TOTALSHAPE][PlacementFinder::MAX_ORIENTATIONS];
+
+    DropTables() {
+        for (int t = 0; t < TETRIS_TOTALSHAPE; ++t) {
+            for (int o = 0; o < PlacementFinder::orientation_count((SHAPE_TYPE)t); ++o) {
+                DropShape& shape = shapes[t][o];
+                PiecePosition origin = {o, 0, 0};
+                coordinate cells[SQUARE_PER_SHAPE];
+                PlacementFinder::cells((SHAPE_TYPE)t, origin, cells);
+                shape.width = 0;
+                std::fill(shape.bottom, shape.bottom + 4, -1);
+                for (unsigned int i = 0; i < SQUARE_PER_SHAPE; ++i) {
+                    shape.width = std::max(shape.width, cells[i].y + 1);
+                    shape.bottom[cells[i].y] = std::max(shape.bottom[cells[i].y], cells[i].x);
+                }
+            }
+        }
+    }
+} drop_tables;
+
+inline uint32_t next_random(uint32_t* seed) {
+    uint32_t x = *seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *seed = x;
+}
+
+}
+
+struct MonteCarloSearch::Node {
+    Bitboard board;
+    std::atomic<int> visits;
+    std::atomic<long long int> value;
+    std::atomic<int> state;
+    // Chance nodes: the decision node for each piece, -1 until drawn
+    std::atomic<int> draws[TETRIS_TOTALSHAPE];
+    // Decision nodes: the chance node of each placement
+    int first_child;
+    int child_count;
+    // Rows cleared and pieces placed since the root
+    int lines;
+    int depth;
+    bool chance;
+    SHAPE_TYPE piece;
+
+    void reset(const Bitboard& from, int from_lines, int from_depth, bool is_chance,
+               SHAPE_TYPE type) {
+        board = from;
+        visits.store(0, std::memory_order_relaxed);
+        value.store(0, std::memory_order_relaxed);
+        state.store(NODE_NEW, std::memory_order_relaxed);
+        for (int t = 0; t < TETRIS_TOTALSHAPE; ++t) {
+            draws[t].store(-1, std::memory_order_relaxed);
+        }
+        first_child = 0;
+        child_count = 0;
+        lines = from_lines;
+        depth = from_depth;
+        chance = is_chance;
+        piece = type;
+    }
+};
+
+struct MonteCarloSearch::Worker {
+    PlacementFinder finder;
+    FeatureBatch batch;
+    uint32_t seed;
+    int path[MAX_PATH];
+    MonteCarloSearch* search;
+    JobSystem::Job job;
+};
+
+MonteCarloSearch::MonteCarloSearch(int nodes, int rollout_pieces, const BotWeights& weights)
+    : pool(new Node[std::max(nodes, 2)]), capacity(std::max(nodes, 2)), used(0), started(0),
+      deepest(0), budget(0), rollout_length(std::max(rollout_pieces, 0)), weights(weights),
+      known_count(0), root_score(0.f) {
+}
+
+MonteCarloSearch::~MonteCarloSearch() {
+    for (size_t i = 0; i < workers.size(); ++i) {
+        delete workers[i];
+    }
+    delete[] pool;
+}
+
+int MonteCarloSearch::nodes_used() const {
+    return std::min(used.load(std::memory_order_relaxed), capacity);
+}
+
+int MonteCarloSearch::allocate(int count) {
+    int first = used.fetch_add(count, std::memory_order_relaxed);
+    return first + count <= capacity ? first : -1;
+}
+
+SHAPE_TYPE MonteCarloSearch::draw(Worker& worker, int depth) const {
+    if (depth < known_count) {
+        return known[depth];
+    }
+    return (SHAPE_TYPE)(next_random(&worker.seed) % TETRIS_TOTALSHAPE);
+}
+
+float MonteCarloSearch::rollout(Worker& worker, Bitboard board, int lines, int depth,
+                                SHAPE_TYPE piece) {
+    const uint32_t FULL_ROW = (1u << TOTAL_COLS) - 1;
+    for (int n = 0; n < rollout_length; ++n, ++depth) {
+        if (n > 0 || piece == TETRIS_TOTALSHAPE) {
+            piece = draw(worker, depth);
+        }
+        // First filled row of each column
+        int top[TOTAL_COLS];
+        std::fill(top, top + TOTAL_COLS, TOTAL_ROWS);
+        uint32_t covered = 0;
+        for (int r = 0; r < TOTAL_ROWS && covered != FULL_ROW; ++r) {
+            for (uint32_t tops = board.rows[r] & ~covered; tops != 0; tops &= tops - 1) {
+                int c = 0;
+                while (!((tops >> c) & 1)) {
+                    ++c;
+                }
+                top[c] = r;
+            }
+            covered |= board.rows[r];
+        }
+
+        // Straight drops only, preferring cleared rows, then no gaps under
+        // the piece, then low landings, with some noise so playouts differ
+        PiecePosition best = {0, 0, 0};
+        float best_score = -1e9f;
+        for (int o = 0; o < PlacementFinder::orientation_count(piece); ++o) {
+            const DropShape& shape = drop_tables.shapes[piece][o];
+            for (int c = 0; c + shape.width <= TOTAL_COLS; ++c) {
+                int row = TOTAL_ROWS;
+                for (int dc = 0; dc < shape.width; ++dc) {
+                    if (shape.bottom[dc] >= 0) {
+                        row = std::min(row, top[c + dc] - 1 - shape.bottom[dc]);
+                    }
+                }
+                if (row < 0) {
+                    continue;
+                }
+                int gaps = 0;
+                for (int dc = 0; dc < shape.width; ++dc) {
+                    if (shape.bottom[dc] >= 0) {
+                        gaps += top[c + dc] - 1 - row - shape.bottom[dc];
+                    }
+                }
+                PiecePosition position = {o, row, c};
+                coordinate cells[SQUARE_PER_SHAPE];
+                PlacementFinder::cells(piece, position, cells);
+                uint32_t rows[SQUARE_PER_SHAPE];
+                int cleared = 0;
+                for (unsigned int i = 0; i < SQUARE_PER_SHAPE; ++i) {
+                    rows[i] = board.rows[cells[i].x];
+                    for (unsigned int j = 0; j < SQUARE_PER_SHAPE; ++j) {
+                        if (cells[j].x == cells[i].x) {
+                            rows[i] |= 1u << cells[j].y;
+                        }
+                    }
+                    // Counted once per row, by its first cell
+                    bool first = true;
+                    for (unsigned int j = 0; j < i; ++j) {
+                        first = first && cells[j].x != cells[i].x;
+                    }
+                    cleared += first && rows[i] == FULL_ROW;
+                }
+                float score = 8.f * cleared - 4.f * gaps + (float)row +
+                              (next_random(&worker.seed) & 255) / 256.f;
+                if (score > best_score) {
+                    best_score = score;
+                    best = position;
+                }
+            }
+        }
+        if (best_score == -1e9f) {
+            return 0.f;
+        }
+        lines += Bot::place(&board, piece, best);
+    }
+    worker.batch.count = 0;
+    Bot::measure(board, lines, &worker.batch);
+    Bot::score(weights, &worker.batch);
+    return 0.5f + 0.5f * std::tanh((worker.batch.score[0] - root_score) / REWARD_SCALE);
+}
+
+int MonteCarloSearch::expand(Worker& worker, Node& node) {
+    int count = worker.finder.find(node.board, node.piece, PlacementFinder::spawn(node.piece));
+    if (count == 0) {
+        node.state.store(NODE_TERMINAL, std::memory_order_release);
+        return NODE_TERMINAL;
+    }
+    int first = allocate(count);
+    if (first < 0) {
+        // Out of nodes, stay a leaf
+        node.state.store(NODE_NEW, std::memory_order_release);
+        return NODE_NEW;
+    }
+    for (int i = 0; i < count; ++i) {
+        Node& child = pool[first + i];
+        child.reset(node.board, node.lines, node.depth + 1, true, TETRIS_TOTALSHAPE);
+        child.lines += Bot::place(&child.board, node.piece, worker.finder.placement(i).position);
+    }
+    node.first_child = first;
+    node.child_count = count;
+    node.state.store(NODE_EXPANDED, std::memory_order_release);
+    return NODE_EXPANDED;
+}
+
+int MonteCarloSearch::select(const Node& node) const {
+    int parent_visits = std::max(node.visits.load(std::memory_order_relaxed), 1);
+    float log_visits = std::log((float)parent_visits);
+    int best = node.first_child;
+    float best_bound = -1.f;
+    for (int i = node.first_child; i < node.first_child + node.child_count; ++i) {
+        int visits = pool[i].visits.load(std::memory_order_relaxed);
+        if (visits == 0) {
+            return i;
+        }
+        float mean = (float)pool[i].value.load(std::memory_order_relaxed) / REWARD_ONE / visits;
+        float bound = mean + EXPLORATION * std::sqrt(log_visits / visits);
+        if (bound > best_bound) {
+            best_bound = bound;
+            best = i;
+        }
+    }
+    return best;
+}
+
+void MonteCarloSearch::playout(Worker& worker) {
+    int length = 0;
+    int index = 0;
+    float reward = 0.f;
+    for (;;) {
+        Node& node = pool[index];
+        int visits = node.visits.fetch_add(1, std::memory_order_relaxed);
+        worker.path[length++] = index;
+        if (length >= MAX_PATH - 1) {
+            reward = rollout(worker, node.board, node.lines, node.depth,
+                             node.chance ? TETRIS_TOTALSHAPE : node.piece);
+            break;
+        }
+        if (node.chance) {
+            SHAPE_TYPE type = draw(worker, node.depth);
+            int child = node.draws[type].load(std::memory_order_acquire);
+            if (child < 0) {
+                child = allocate(1);
+                if (child < 0) {
+                    reward = rollout(worker, node.board, node.lines, node.depth, type);
+                    break;
+                }
+                pool[child].reset(node.board, node.lines, node.depth, false, type);
+                int expected = -1;
+                if (!node.draws[type].compare_exchange_strong(expected, child,
+                                                              std::memory_order_acq_rel)) {
+                    // Another thread drew it first, its node is wasted
+                    child = expected;
+                }
+            }
+            index = child;
+            continue;
+        }
+
+        // A new leaf is played out once before it is expanded
+        int state = node.state.load(std::memory_order_acquire);
+        if (state == NODE_NEW && visits > 0 &&
+            node.state.compare_exchange_strong(state, NODE_EXPANDING,
+                                               std::memory_order_acquire)) {
+            state = expand(worker, node);
+        }
+        if (state == NODE_TERMINAL) {
+            reward = 0.f;
+            break;
+        }
+        if (state != NODE_EXPANDED) {
+            reward = rollout(worker, node.board, node.lines, node.depth, node.piece);
+            break;
+        }
+        index = select(node);
+    }
+
+    long long int value = (long long int)(reward * REWARD_ONE);
+    for (int i = 0; i < length; ++i) {
+        pool[worker.path[i]].value.fetch_add(value, std::memory_order_relaxed);
+    }
+    int depth = pool[worker.path[length - 1]].depth;
+    int seen = deepest.load(std::memory_order_relaxed);
+    while (depth > seen && !deepest.compare_exchange_weak(seen, depth,
+                                                          std::memory_order_relaxed)) {
+    }
+}
+
+void MonteCarloSearch::play(Worker& worker) {
+    while (started.fetch_add(1, std::memory_order_relaxed) < budget) {
+        playout(worker);
+    }
+}
+
+void MonteCarloSearch::play_job(void* worker) {
+    Worker* self = static_cast<Worker*>(worker);
+    self->search->play(*self);
+}
+
+int MonteCarloSearch::choose(const Bitboard& board, const SHAPE_TYPE* pieces, int count,
+                             const PiecePosition& start, int playouts) {
+    known_count = std::min(std::max(count, 1), MAX_PIECES);
+    std::copy(pieces, pieces + known_count, known);
+    int threads = JobSystem::worker_count();
+    while ((int)workers.size() < threads) {
+        Worker* worker = new Worker();
+        worker->seed = 2654435761u * (uint32_t)(workers.size() + 1);
+        worker->search = this;
+        workers.push_back(worker);
+    }
+
+    // The whole pool is free again
+    used.store(0, std::memory_order_relaxed);
+    deepest.store(0, std::memory_order_relaxed);
+    Worker& own = *workers[0];
+    own.batch.count = 0;
+    Bot::measure(board, 0, &own.batch);
+    Bot::score(weights, &own.batch);
+    root_score = own.batch.score[0];
+
+    // The root is expanded here, from where the piece is, so the children
+    // line up with finder()
+    int root = allocate(1);
+    pool[root].reset(board, 0, 0, false, pieces[0]);
+    int placements = root_finder.find(board, pieces[0], start);
+    if (placements == 0) {
+        return -1;
+    }
+    int first = allocate(placements);
+    if (first < 0) {
+        return 0;
+    }
+    for (int i = 0; i < placements; ++i) {
+        Node& child = pool[first + i];
+        child.reset(board, 0, 1, true, TETRIS_TOTALSHAPE);
+        child.lines = Bot::place(&child.board, pieces[0], root_finder.placement(i).position);
+    }
+    pool[root].first_child = first;
+    pool[root].child_count = placements;
+    pool[root].state.store(NODE_EXPANDED, std::memory_order_relaxed);
+
+    budget = playouts;
+    started.store(0, std::memory_order_relaxed);
+    {
+        JobSystem::TaskGroup group;
+        for (int t = 1; t < threads; ++t) {
+            group.run(&workers[t]->job, play_job, workers[t]);
+        }
+        play(own);
+        group.wait();
+    }
+
+    // The most visited placement; its value decides a tie
+    int best = 0;
+    for (int i = 1; i < placements; ++i) {
+        const Node& child = pool[first + i];
+        const Node& leader = pool[first + best];
+        int visits = child.visits.load(std::memory_order_relaxed);
+        int leader_visits = leader.visits.load(std::memory_order_relaxed);
+        if (visits > leader_visits ||
+            (visits == leader_visits && child.value.load() > leader.value.load())) {
+            best = i;
+        }
+    }
+    return best;
+}
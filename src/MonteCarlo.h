@@ -0,0 +1,87 @@
+#ifndef MONTE_CARLO_H
+#define MONTE_CARLO_H
+
+#include "Bot.h"
+
+#include <atomic>
+#include <vector>
+
+// Monte Carlo tree search over placements. Decision nodes hold a board
+// and the piece to place; their children are the placements PlacementFinder
+// finds, each a chance node whose children are the pieces the randomizer
+// may draw next. Pieces already known, the current one and the preview,
+// are drawn as they are. A playout walks down by UCT, plays a few pieces
+// further with a cheap hard-drop policy and scores the board it ends on
+// with the Bot weights.
+//
+// Every JobSystem worker runs playouts on the one shared tree:
+// - a thread claims a node's expansion with a compare-and-swap, the others
+//   play out from that node meanwhile instead of waiting
+// - a visit counts as soon as a thread passes, its reward only when the
+//   playout is done, so threads passing meanwhile see a worse node (the
+//   virtual loss) and spread out
+// - nodes come from a pool allocated once and emptied for every move, and
+//   each worker's job lives with its scratch, so a search allocates nothing
+//
+// Keeps its pool and worker scratch between calls, so use one search per
+// thread.
+class MonteCarloSearch {
+public:
+    static const int MAX_PIECES = 8;
+
+    // nodes is the size of the pool; when it runs out the tree stops
+    // growing and playouts start from its leaves
+    explicit MonteCarloSearch(int nodes = 1 << 16, int rollout_pieces = 6,
+                              const BotWeights& weights = BotWeights::defaults());
+    ~MonteCarloSearch();
+
+    MonteCarloSearch(const MonteCarloSearch&) = delete;
+    MonteCarloSearch& operator=(const MonteCarloSearch&) = delete;
+
+    // pieces[0] is the current piece, at start; the others are the
+    // preview. Runs the given number of playouts and returns the index
+    // into finder() of the most visited placement, -1 when the start is
+    // blocked.
+    int choose(const Bitboard& board, const SHAPE_TYPE* pieces, int count,
+               const PiecePosition& start, int playouts);
+
+    const PlacementFinder& finder() const { return root_finder; }
+    // Of the last choose()
+    int nodes_used() const;
+    int max_depth() const { return deepest.load(std::memory_order_relaxed); }
+
+    // Defined in MonteCarlo.cpp
+    struct Node;
+    struct Worker;
+
+private:
+    int allocate(int count);
+    void playout(Worker& worker);
+    // Runs playouts until the budget is used up
+    void play(Worker& worker);
+    // A JobSystem job running play() for a worker
+    static void play_job(void* worker);
+    // The state of node after trying to expand it
+    int expand(Worker& worker, Node& node);
+    int select(const Node& node) const;
+    SHAPE_TYPE draw(Worker& worker, int depth) const;
+    // Reward in [0, 1] of playing on from board; piece is the first piece
+    // or TETRIS_TOTALSHAPE to draw it
+    float rollout(Worker& worker, Bitboard board, int lines, int depth, SHAPE_TYPE piece);
+
+    Node* pool;
+    int capacity;
+    std::atomic<int> used;
+    std::atomic<int> started;
+    std::atomic<int> deepest;
+    int budget;
+    int rollout_length;
+    BotWeights weights;
+    PlacementFinder root_finder;
+    std::vector<Worker*> workers;
+    SHAPE_TYPE known[MAX_PIECES];
+    int known_count;
+    float root_score;
+};
+
+#endif
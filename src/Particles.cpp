@@ -0,0 +1,214 @@
+#include "Particles.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const float GRAVITY = -2.5f;
+const float DRAG = 0.98f;
+const float PARTICLE_SIZE = 0.01f;
+const float CELL_SIZE = 0.1f;
+
+// Instance attributes fed from the first GPU_FIELDS columns of the state
+const char* FIELD_ATTRIBS[Particles::GPU_FIELDS] = {"pos_x", "pos_y", "life", "hue"};
+
+// Board cell (row, col) to the normalized device coordinates of its center,
+// matching the placement done by the OglRect constructor
+float cell_center_x(int col) {
+    return (col - 9.5f) * CELL_SIZE;
+}
+
+float cell_center_y(int row) {
+    return (9.5f - row) * CELL_SIZE;
+}
+
+}
+
+const GLchar* Particles::vertex_shader =
+            "#version 150 core\n"
+                    "in vec2 corner;"
+                    "in float pos_x;"
+                    "in float pos_y;"
+                    "in float life;"
+                    "in float hue;"
+                    "uniform float size;"
+                    "out vec4 f_color;"
+                    "void main()"
+                    "{"
+                    "    vec3 rgb = clamp(abs(mod(hue * 6.0 + vec3(0.0, 4.0, 2.0), 6.0) - 3.0) - 1.0, 0.0, 1.0);"
+                    "    gl_Position = vec4(vec2(pos_x, pos_y) + corner * size * (0.5 + 0.5 * life), 0.0, 1.0);"
+                    "    f_color = vec4(rgb, life);"
+                    "}";
+
+const GLchar* Particles::fragment_shader =
+        "#version 150 core\n"
+                "in vec4 f_color;"
+                "out vec4 outColor;"
+                "void main()"
+                "{"
+                "    outColor = f_color;"
+                "}";
+
+const int Particles::PER_CLEARED_CELL;
+const int Particles::CLEAR_BUDGET;
+
+Program Particles::program;
+VertexArrayObject Particles::VAO;
+VertexBufferObject Particles::VBO;
+VertexBufferObject Particles::VBO_I;
+
+Eigen::ArrayXXf Particles::state;
+int Particles::alive = 0;
+unsigned int Particles::seed = 2463534242u;
+
+void Particles::init() {
+    state.setZero(CAPACITY, TOTAL_FIELDS);
+    alive = 0;
+
+    Eigen::MatrixXf corners(2, 4);
+    corners << -1., 1., -1., 1.,
+               -1., -1., 1., 1.;
+
+    program.init(vertex_shader, fragment_shader, "outColor");
+    program.bind();
+    glUniform1f(program.uniform("size"), PARTICLE_SIZE);
+
+    VAO.init();
+    VAO.bind();
+
+    VBO.init();
+    VBO.update(corners);
+    program.bindVertexAttribArray("corner", VBO);
+
+    // Per instance storage for the shader visible fields, one float per
+    // particle and field, laid out column by column like the state
+    VBO_I.init();
+    VBO_I.init_regions(FRAME_REGIONS, 1, CAPACITY * GPU_FIELDS);
+    for (int f = 0; f < GPU_FIELDS; ++f) {
+        GLint id = program.bindVertexAttribArray(FIELD_ATTRIBS[f], VBO_I, 1, f * CAPACITY);
+        if (id >= 0) {
+            glVertexAttribDivisor(id, 1);
+        }
+    }
+    check_gl_error();
+}
+
+void Particles::teardown() {
+    program.free();
+    VAO.free();
+    VBO.free();
+    VBO_I.free();
+}
+
+float Particles::random01() {
+    // xorshift32, good enough for visual noise and allocation free
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return (seed & 0xFFFFFF) / (float)0x1000000;
+}
+
+void Particles::spawn(float x, float y, float hue, float speed) {
+    if (alive >= CAPACITY) {
+        return;
+    }
+
+    float angle = random01() * 6.2831853f;
+    float v = speed * (0.3f + 0.7f * random01());
+    float life = 0.6f + 0.6f * random01();
+
+    state(alive, POS_X) = x + (random01() - 0.5f) * CELL_SIZE;
+    state(alive, POS_Y) = y + (random01() - 0.5f) * CELL_SIZE;
+    state(alive, VEL_X) = v * std::cos(angle);
+    state(alive, VEL_Y) = v * std::sin(angle) + 0.5f * speed;
+    state(alive, LIFE) = 1.f;
+    state(alive, MAX_LIFE) = life;
+    state(alive, HUE) = hue;
+    ++alive;
+}
+
+void Particles::emit_rows(const int* rows, int count, int total_cols) {
+    if (count == 0) {
+        return;
+    }
+
+    int room = std::max(CLEAR_BUDGET - alive, 0);
+    int per_cell = std::min(PER_CLEARED_CELL, room / (count * total_cols));
+    for (int r = 0; r < count; ++r) {
+        float y = cell_center_y(rows[r]);
+        for (int col = 0; col < total_cols; ++col) {
+            float x = cell_center_x(col);
+            for (int k = 0; k < per_cell; ++k) {
+                spawn(x, y, (float)col / total_cols, 1.2f);
+            }
+        }
+    }
+}
+
+void Particles::emit_cell(int row, int col, int count, float hue) {
+    float x = cell_center_x(col);
+    float y = cell_center_y(row);
+    for (int k = 0; k < count; ++k) {
+        spawn(x, y, hue, 0.4f);
+    }
+}
+
+void Particles::update(float dt) {
+    if (alive == 0) {
+        return;
+    }
+
+    // Whole column expressions, evaluated four lanes at a time by Eigen
+    float drag = std::pow(DRAG, dt * 60.f);
+    state.col(VEL_Y).head(alive) += GRAVITY * dt;
+    state.col(VEL_X).head(alive) *= drag;
+    state.col(VEL_Y).head(alive) *= drag;
+    state.col(POS_X).head(alive) += state.col(VEL_X).head(alive) * dt;
+    state.col(POS_Y).head(alive) += state.col(VEL_Y).head(alive) * dt;
+    state.col(LIFE).head(alive) -= dt / state.col(MAX_LIFE).head(alive);
+
+    // Swap dead particles with the last live one to keep the arrays dense
+    int i = 0;
+    while (i < alive) {
+        if (state(i, LIFE) > 0.f) {
+            ++i;
+            continue;
+        }
+        --alive;
+        if (i != alive) {
+            for (int f = 0; f < TOTAL_FIELDS; ++f) {
+                state(i, f) = state(alive, f);
+            }
+        }
+    }
+}
+
+void Particles::render() {
+    if (alive == 0) {
+        return;
+    }
+
+    // Only the live prefix of each shader visible column goes up
+    float* dst = VBO_I.map_region();
+    for (int f = 0; f < GPU_FIELDS; ++f) {
+        std::copy(state.col(f).data(), state.col(f).data() + alive, dst + f * CAPACITY);
+    }
+    VBO_I.unmap_region();
+
+    // Instanced attributes can not be offset by the draw call, so they are
+    // pointed at the region written this frame
+    VAO.bind();
+    program.bind();
+    for (int f = 0; f < GPU_FIELDS; ++f) {
+        program.bindVertexAttribArray(FIELD_ATTRIBS[f], VBO_I, 1,
+                                      VBO_I.region_offset() + f * CAPACITY);
+    }
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, alive);
+    glDisable(GL_BLEND);
+    VBO_I.fence_region();
+    check_gl_error();
+}
@@ -0,0 +1,66 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include "Helpers.h"
+
+// Burst effects for cleared rows and locked pieces.
+// Particle state is kept as structure of arrays: every field is one column
+// of an Eigen array, so the per-frame update runs on whole columns with
+// Eigen's SSE packet math. The live particles are drawn with a single
+// instanced call whose per instance attributes read straight from a buffer
+// laid out exactly like the first columns of the state.
+class Particles {
+public:
+    enum FIELD {
+        POS_X,
+        POS_Y,
+        LIFE,
+        HUE,
+        VEL_X,
+        VEL_Y,
+        MAX_LIFE,
+        TOTAL_FIELDS
+    };
+    // Fields read by the vertex shader, stored first so they can be uploaded
+    static const int GPU_FIELDS = 4;
+    static const int CAPACITY = 16384;
+    static const int PER_CLEARED_CELL = 50;
+    // Live particles a line clear may bring the total up to. Rows cleared
+    // together share it, so a four-line clear gets 500 per line instead of
+    // 1000: at 4000 live particles llvmpipe went over the 16.6 ms frame.
+    static const int CLEAR_BUDGET = 2000;
+    static const int PER_LOCKED_CELL = 16;
+    // Frames of instance data the GPU may still be reading while we write
+    static const int FRAME_REGIONS = 3;
+
+    static const GLchar* vertex_shader;
+    static const GLchar* fragment_shader;
+    static Program program;
+    static VertexArrayObject VAO;
+    static VertexBufferObject VBO;
+    // Instance attributes, a copy of the first GPU_FIELDS columns
+    static VertexBufferObject VBO_I;
+
+    // CAPACITY x TOTAL_FIELDS, column major so each field is contiguous
+    static Eigen::ArrayXXf state;
+    static int alive;
+    static unsigned int seed;
+
+    static void init();
+    static void teardown();
+
+    // Bursts along rows removed together by check_grid
+    static void emit_rows(const int* rows, int count, int total_cols);
+    // Small puff on every cell of a piece locked by persist()
+    static void emit_cell(int row, int col, int count, float hue);
+
+    // Advances every live particle by dt seconds and drops the dead ones
+    static void update(float dt);
+    static void render();
+
+private:
+    static float random01();
+    static void spawn(float x, float y, float hue, float speed);
+};
+
+#endif
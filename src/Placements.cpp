@@ -0,0 +1,388 @@
+#include "Placements.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// One orientation of a piece, as TetrisShape::morph() cycles through them.
+// Offsets are (row, col) from the top left of the bounding box.
+struct Orientation {
+    int cells[SQUARE_PER_SHAPE][2];
+    // Orientation after a rotation and how far the box moves, -1 when the
+    // piece does not rotate
+    int next;
+    int rotate_dr;
+    int rotate_dc;
+    // Cells TetrisShape::can_morph() requires to be free, and the box
+    // positions it allows at all
+    int checked_count;
+    int checked[SQUARE_PER_SHAPE][2];
+    int rotate_rows[2];
+    int rotate_cols[2];
+};
+
+struct PieceTable {
+    int count;
+    Orientation orientations[PlacementFinder::MAX_ORIENTATIONS];
+    PiecePosition spawn;
+};
+
+// Transcribed from the morph and can_morph functions in Helpers.cpp, in
+// SHAPE_TYPE order
+const PieceTable PIECES[TETRIS_TOTALSHAPE] = {
+    // TETRIS_LSHAPE: down, left, up, right
+    {4, {
+        {{{0, 0}, {0, 1}, {0, 2}, {1, 2}}, 1, 0, 1,
+         3, {{0, 2}, {1, 2}, {2, 2}}, {0, 17}, {0, 17}},
+        {{{0, 1}, {1, 1}, {2, 1}, {2, 0}}, 2, 1, -1,
+         4, {{1, -1}, {2, -1}, {2, 0}, {2, 1}}, {0, 17}, {2, 18}},
+        {{{1, 2}, {1, 1}, {1, 0}, {0, 0}}, 3, -1, 0,
+         4, {{-1, 0}, {-1, 1}, {0, 0}, {1, 0}}, {2, 18}, {0, 17}},
+        {{{2, 0}, {1, 0}, {0, 0}, {0, 1}}, 0, 0, 0,
+         4, {{0, 0}, {0, 1}, {0, 2}, {1, 2}}, {0, 17}, {0, 17}}},
+     {0, 0, 10}},
+    // TETRIS_GAMMASHAPE: down, right, up, left
+    {4, {
+        {{{0, 2}, {0, 1}, {0, 0}, {1, 0}}, 1, 0, 0,
+         3, {{0, 0}, {1, 0}, {2, 0}}, {0, 17}, {0, 17}},
+        {{{0, 0}, {1, 0}, {2, 0}, {2, 1}}, 2, 1, 0,
+         4, {{1, 2}, {2, 0}, {2, 1}, {2, 2}}, {0, 17}, {0, 17}},
+        {{{1, 0}, {1, 1}, {1, 2}, {0, 2}}, 3, -1, 1,
+         4, {{-1, 1}, {-1, 2}, {0, 2}, {1, 2}}, {2, 18}, {0, 17}},
+        {{{2, 1}, {1, 1}, {0, 1}, {0, 0}}, 0, 0, -1,
+         4, {{0, -1}, {0, 0}, {0, 1}, {1, -1}}, {0, 17}, {2, 18}}},
+     {0, 0, 8}},
+    // TETRIS_STRIPSHAPE: landscape, portrait
+    {2, {
+        {{{0, 0}, {0, 1}, {0, 2}, {0, 3}}, 1, 0, 0,
+         4, {{0, 0}, {1, 0}, {2, 0}, {3, 0}}, {0, 16}, {0, 16}},
+        {{{0, 0}, {1, 0}, {2, 0}, {3, 0}}, 0, 0, 0,
+         4, {{0, 0}, {0, 1}, {0, 2}, {0, 3}}, {0, 16}, {0, 16}}},
+     {0, 0, 10}},
+    // TETRIS_TSHAPE: down, left, up, right
+    {4, {
+        {{{0, 0}, {0, 1}, {0, 2}, {1, 1}}, 1, -1, 0,
+         1, {{-1, 1}}, {1, 18}, {0, 17}},
+        {{{0, 1}, {1, 1}, {2, 1}, {1, 0}}, 2, 0, 0,
+         1, {{1, 2}}, {0, 17}, {0, 17}},
+        {{{1, 0}, {1, 1}, {1, 2}, {0, 1}}, 3, 0, 1,
+         1, {{2, 1}}, {0, 17}, {0, 17}},
+        {{{2, 0}, {1, 0}, {0, 0}, {1, 1}}, 0, 1, -1,
+         1, {{1, -1}}, {0, 17}, {1, 18}}},
+     {0, 0, 10}},
+    // TETRIS_SQUARESHAPE
+    {1, {
+        {{{0, 0}, {0, 1}, {1, 0}, {1, 1}}, -1, 0, 0,
+         0, {}, {0, 0}, {0, 0}}},
+     {0, 0, 10}},
+    // TETRIS_LEFTNSHAPE: vertical, horizontal
+    {2, {
+        {{{0, 0}, {1, 0}, {1, 1}, {2, 1}}, 1, 1, 0,
+         2, {{1, 2}, {2, 0}}, {0, 17}, {0, 17}},
+        {{{1, 0}, {1, 1}, {0, 1}, {0, 2}}, 0, -1, 0,
+         2, {{-1, 0}, {1, 1}}, {1, 18}, {0, 17}}},
+     {0, 0, 10}},
+    // TETRIS_RIGHTNSHAPE: vertical, horizontal
+    {2, {
+        {{{0, 1}, {1, 1}, {1, 0}, {2, 0}}, 1, 1, 0,
+         2, {{2, 1}, {2, 2}}, {0, 17}, {0, 17}},
+        {{{0, 0}, {0, 1}, {1, 1}, {1, 2}}, 0, -1, 0,
+         2, {{-1, 1}, {1, 0}}, {1, 18}, {0, 17}}},
+     {0, 0, 9}},
+};
+
+// Derived from PIECES once, at static initialization
+struct Extent {
+    int height;
+    int width;
+    // Bit dr * 4 + dc for every cell, to compare cell sets
+    uint16_t shape;
+};
+Extent extents[TETRIS_TOTALSHAPE][PlacementFinder::MAX_ORIENTATIONS];
+
+struct ExtentInit {
+    ExtentInit() {
+        for (int t = 0; t < TETRIS_TOTALSHAPE; ++t) {
+            for (int o = 0; o < PIECES[t].count; ++o) {
+                Extent& extent = extents[t][o];
+                extent.height = 0;
+                extent.width = 0;
+                extent.shape = 0;
+                for (unsigned int i = 0; i < SQUARE_PER_SHAPE; ++i) {
+                    const int* cell = PIECES[t].orientations[o].cells[i];
+                    extent.height = std::max(extent.height, cell[0] + 1);
+                    extent.width = std::max(extent.width, cell[1] + 1);
+                    extent.shape |= 1 << (cell[0] * 4 + cell[1]);
+                }
+            }
+        }
+    }
+} extent_init;
+
+inline int lowest_bit(uint32_t mask) {
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#else
+    int bit = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+inline bool is_set(uint32_t mask, int col) {
+    return (mask >> col) & 1;
+}
+
+}
+
+Bitboard Bitboard::from_grid(const bool grid[TOTAL_ROWS][TOTAL_COLS]) {
+    Bitboard board;
+    for (int r = 0; r < TOTAL_ROWS; ++r) {
+        board.rows[r] = 0;
+        for (int c = 0; c < TOTAL_COLS; ++c) {
+            if (grid[r][c]) {
+                board.rows[r] |= 1u << c;
+            }
+        }
+    }
+    return board;
+}
+
+PiecePosition PlacementFinder::spawn(SHAPE_TYPE type) {
+    return PIECES[type].spawn;
+}
+
+int PlacementFinder::orientation_count(SHAPE_TYPE type) {
+    return PIECES[type].count;
+}
+
+bool PlacementFinder::locate(SHAPE_TYPE type, const coordinate cells[SQUARE_PER_SHAPE],
+                             PiecePosition* position) {
+    int row = cells[0].x;
+    int col = cells[0].y;
+    for (unsigned int i = 1; i < SQUARE_PER_SHAPE; ++i) {
+        row = std::min(row, cells[i].x);
+        col = std::min(col, cells[i].y);
+    }
+    uint16_t shape = 0;
+    for (unsigned int i = 0; i < SQUARE_PER_SHAPE; ++i) {
+        int dr = cells[i].x - row;
+        int dc = cells[i].y - col;
+        if (dr > 3 || dc > 3) {
+            return false;
+        }
+        shape |= 1 << (dr * 4 + dc);
+    }
+    for (int o = 0; o < PIECES[type].count; ++o) {
+        if (extents[type][o].shape == shape) {
+            position->orientation = o;
+            position->row = row;
+            position->col = col;
+            return true;
+        }
+    }
+    return false;
+}
+
+void PlacementFinder::cells(SHAPE_TYPE type, const PiecePosition& position,
+                            coordinate out[SQUARE_PER_SHAPE]) {
+    const Orientation& shape = PIECES[type].orientations[position.orientation];
+    for (unsigned int i = 0; i < SQUARE_PER_SHAPE; ++i) {
+        out[i] = coordinate(position.row + shape.cells[i][0], position.col + shape.cells[i][1]);
+    }
+}
+
+int PlacementFinder::find(const Bitboard& board, SHAPE_TYPE type, const PiecePosition& start) {
+    const PieceTable& piece = PIECES[type];
+    const int count = piece.count;
+    piece_type = type;
+    placement_count = 0;
+
+    // A cell at column offset dc rules out every box column c with
+    // board bit c + dc set
+    for (int o = 0; o < count; ++o) {
+        const Orientation& shape = piece.orientations[o];
+        const Extent& extent = extents[type][o];
+        uint32_t columns = (1u << (TOTAL_COLS - extent.width + 1)) - 1;
+        for (int r = 0; r < TOTAL_ROWS; ++r) {
+            if (r > TOTAL_ROWS - extent.height) {
+                fits[o][r] = 0;
+                continue;
+            }
+            uint32_t mask = columns;
+            for (unsigned int i = 0; i < SQUARE_PER_SHAPE; ++i) {
+                mask &= ~(board.rows[r + shape.cells[i][0]] >> shape.cells[i][1]);
+            }
+            fits[o][r] = mask;
+        }
+        for (int r = 0; r < TOTAL_ROWS; ++r) {
+            rests[o][r] = fits[o][r] & ~(r + 1 < TOTAL_ROWS ? fits[o][r + 1] : 0);
+        }
+    }
+
+    // Where can_morph() allows a rotation and the rotated piece fits
+    for (int o = 0; o < count; ++o) {
+        const Orientation& shape = piece.orientations[o];
+        for (int r = 0; r < TOTAL_ROWS; ++r) {
+            rotates[o][r] = 0;
+            int to_r = r + shape.rotate_dr;
+            if (shape.next < 0 || r < shape.rotate_rows[0] || r > shape.rotate_rows[1] ||
+                to_r < 0 || to_r >= TOTAL_ROWS) {
+                continue;
+            }
+            uint32_t mask = fits[o][r] & (((1u << (shape.rotate_cols[1] + 1)) - 1) &
+                                          ~((1u << shape.rotate_cols[0]) - 1));
+            for (int i = 0; i < shape.checked_count; ++i) {
+                int cr = r + shape.checked[i][0];
+                int dc = shape.checked[i][1];
+                if (cr < 0 || cr >= TOTAL_ROWS) {
+                    mask = 0;
+                } else if (dc >= 0) {
+                    mask &= ~(board.rows[cr] >> dc);
+                } else {
+                    // Columns left of the board count as filled
+                    mask &= ~((board.rows[cr] << -dc) | ((1u << -dc) - 1));
+                }
+            }
+            uint32_t target = fits[shape.next][to_r];
+            mask &= shape.rotate_dc >= 0 ? target >> shape.rotate_dc : target << -shape.rotate_dc;
+            rotates[o][r] = mask;
+        }
+    }
+
+    if (start.row < 0 || start.row >= TOTAL_ROWS || start.col < 0 ||
+        !is_set(fits[start.orientation][start.row], start.col)) {
+        return 0;
+    }
+
+    // The masks of the orientations in use are contiguous
+    const int row_count = count * TOTAL_ROWS;
+    memset(visited, 0, sizeof(uint32_t) * row_count);
+    memset(rotated, 0, sizeof(uint32_t) * row_count);
+    memset(layers[0], 0, sizeof(uint32_t) * row_count);
+    layers[0][start.orientation][start.row] = 1u << start.col;
+
+    int inputs = 0;
+    for (;;) {
+        uint32_t any = 0;
+        for (int o = 0; o < count; ++o) {
+            uint32_t* reached = layers[inputs][o];
+            for (int r = 0; r < TOTAL_ROWS; ++r) {
+                uint32_t mask = (reached[r] | rotated[o][r]) & fits[o][r] & ~visited[o][r];
+                rotated[o][r] = 0;
+                visited[o][r] |= mask;
+                reached[r] = mask;
+                any |= mask;
+                // Nothing moves down from a rest, the piece locks there
+                uint32_t locked = mask & rests[o][r];
+                while (locked != 0) {
+                    Placement& placement = placements[placement_count++];
+                    placement.position.orientation = o;
+                    placement.position.row = r;
+                    placement.position.col = lowest_bit(locked);
+                    placement.inputs = inputs;
+                    locked &= locked - 1;
+                }
+            }
+        }
+        if (any == 0 || inputs == MAX_INPUTS) {
+            break;
+        }
+
+        // One more input from every state just reached; the masks are
+        // trimmed to where the piece fits at the top of the next round
+        for (int o = 0; o < count; ++o) {
+            const uint32_t* from = layers[inputs][o];
+            uint32_t* to = layers[inputs + 1][o];
+            to[0] = (from[0] << 1) | (from[0] >> 1);
+            for (int r = 1; r < TOTAL_ROWS; ++r) {
+                to[r] = (from[r] << 1) | (from[r] >> 1) | from[r - 1];
+            }
+            // Columns still dropping into each row
+            uint32_t falling = 0;
+            for (int r = 0; r < TOTAL_ROWS; ++r) {
+                to[r] |= falling & rests[o][r];
+                falling = (falling | from[r]) & ~rests[o][r];
+            }
+            const Orientation& shape = piece.orientations[o];
+            if (shape.next < 0) {
+                continue;
+            }
+            // rotates[o] is 0 wherever the rotation would leave the board
+            uint32_t* turned = rotated[shape.next];
+            int first = std::max(0, -shape.rotate_dr);
+            int last = std::min(TOTAL_ROWS, TOTAL_ROWS - shape.rotate_dr);
+            if (shape.rotate_dc >= 0) {
+                for (int r = first; r < last; ++r) {
+                    turned[r + shape.rotate_dr] |= (from[r] & rotates[o][r]) << shape.rotate_dc;
+                }
+            } else {
+                for (int r = first; r < last; ++r) {
+                    turned[r + shape.rotate_dr] |= (from[r] & rotates[o][r]) >> -shape.rotate_dc;
+                }
+            }
+        }
+        ++inputs;
+    }
+    return placement_count;
+}
+
+int PlacementFinder::path(int i, PLACEMENT_INPUT* inputs, int max_inputs) const {
+    const PieceTable& piece = PIECES[piece_type];
+    int length = placements[i].inputs;
+    if (length > max_inputs) {
+        return -1;
+    }
+    // Walk back through the layers, each time to any state one input
+    // earlier that leads here
+    int o = placements[i].position.orientation;
+    int r = placements[i].position.row;
+    int c = placements[i].position.col;
+    for (int k = length - 1; k >= 0; --k) {
+        const RowMasks& before = layers[k];
+        if (is_set(before[o][r], c + 1)) {
+            inputs[k] = PLACE_LEFT;
+            ++c;
+            continue;
+        }
+        if (c > 0 && is_set(before[o][r], c - 1)) {
+            inputs[k] = PLACE_RIGHT;
+            --c;
+            continue;
+        }
+        if (r > 0 && is_set(before[o][r - 1], c)) {
+            inputs[k] = PLACE_DOWN;
+            --r;
+            continue;
+        }
+        bool found = false;
+        if (is_set(rests[o][r], c)) {
+            for (int above = r - 1; above >= 0 && is_set(fits[o][above], c); --above) {
+                if (is_set(before[o][above], c)) {
+                    inputs[k] = PLACE_DROP;
+                    r = above;
+                    found = true;
+                    break;
+                }
+            }
+        }
+        for (int from = 0; from < piece.count && !found; ++from) {
+            const Orientation& shape = piece.orientations[from];
+            int from_r = r - shape.rotate_dr;
+            int from_c = c - shape.rotate_dc;
+            if (shape.next == o && from_r >= 0 && from_r < TOTAL_ROWS && from_c >= 0 &&
+                is_set(before[from][from_r] & rotates[from][from_r], from_c)) {
+                inputs[k] = PLACE_ROTATE;
+                o = from;
+                r = from_r;
+                c = from_c;
+                found = true;
+            }
+        }
+    }
+    return length;
+}
@@ -0,0 +1,100 @@
+#ifndef PLACEMENTS_H
+#define PLACEMENTS_H
+
+#include "Shapes.h"
+
+#include <cstdint>
+
+// One bit per cell: bit c of rows[r] is board_grid[r][c]
+struct Bitboard {
+    uint32_t rows[TOTAL_ROWS];
+
+    static Bitboard from_grid(const bool grid[TOTAL_ROWS][TOTAL_COLS]);
+};
+
+// Inputs of a path, one key press each
+enum PLACEMENT_INPUT {
+    PLACE_LEFT,
+    PLACE_RIGHT,
+    PLACE_DOWN,
+    PLACE_ROTATE,
+    PLACE_DROP
+};
+
+// A piece position: the orientation and the top left corner of the
+// piece's bounding box
+struct PiecePosition {
+    int orientation;
+    int row;
+    int col;
+};
+
+struct Placement {
+    PiecePosition position;
+    // Inputs in the shortest path from the start
+    int inputs;
+};
+
+// Finds every position a piece can lock in, by breadth-first search over
+// (orientation, row, col) with the moves and rotations of TetrisShape, so
+// slides under overhangs and rotations into them count too. The search
+// runs on bit masks, a whole row of columns at a time: for each
+// orientation and row one mask holds the columns the piece fits in, and
+// each step of the search turns the masks of the states first reached
+// with n inputs into those first reached with n + 1. Paths are rebuilt
+// from these masks only when asked for.
+//
+// Rotations follow TetrisShape::morph() and are allowed only where
+// TetrisShape::can_morph() would allow them and the rotated piece does
+// not overlap the board.
+//
+// Keeps its scratch space between calls, so use one finder per thread.
+class PlacementFinder {
+public:
+    static const int MAX_ORIENTATIONS = 4;
+    static const int MAX_PLACEMENTS = MAX_ORIENTATIONS * TOTAL_ROWS * TOTAL_COLS;
+    // Longest path searched; only a maze-like board needs more
+    static const int MAX_INPUTS = 127;
+
+    // Where TetrisShape(type) starts
+    static PiecePosition spawn(SHAPE_TYPE type);
+    // The position of a piece's cells; false when they are not one of
+    // its orientations
+    static bool locate(SHAPE_TYPE type, const coordinate cells[SQUARE_PER_SHAPE],
+                       PiecePosition* position);
+    static int orientation_count(SHAPE_TYPE type);
+    static void cells(SHAPE_TYPE type, const PiecePosition& position,
+                      coordinate out[SQUARE_PER_SHAPE]);
+
+    // Returns how many placements there are, 0 when the start is blocked.
+    // They come in order of path length.
+    int find(const Bitboard& board, SHAPE_TYPE type, const PiecePosition& start);
+
+    int count() const { return placement_count; }
+    const Placement& placement(int i) const { return placements[i]; }
+
+    // Writes the inputs from the start to placement i; returns how many
+    // there are, or -1 when they do not fit in max_inputs
+    int path(int i, PLACEMENT_INPUT* inputs, int max_inputs) const;
+
+private:
+    typedef uint32_t RowMasks[MAX_ORIENTATIONS][TOTAL_ROWS];
+
+    SHAPE_TYPE piece_type;
+    int placement_count;
+    Placement placements[MAX_PLACEMENTS];
+    // Columns the piece fits in, per orientation and row
+    RowMasks fits;
+    // Columns where it fits and can not move down, so a drop stops there
+    RowMasks rests;
+    // Columns a rotation is allowed from
+    RowMasks rotates;
+    RowMasks visited;
+    // Rotations into the next layer, kept apart so the moves within an
+    // orientation can be written in one pass
+    RowMasks rotated;
+    // States first reached with n inputs
+    RowMasks layers[MAX_INPUTS + 1];
+};
+
+#endif
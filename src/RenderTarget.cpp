@@ -0,0 +1,279 @@
+#include "RenderTarget.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cctype>
+#include <cstring>
+
+const RenderTarget::Profile RenderTarget::profiles[TOTAL_PROFILES] = {
+    { "LOW",    0.5f,  0 },
+    { "MEDIUM", 1.0f,  0 },
+    { "HIGH",   1.0f,  4 }
+};
+
+const double RenderTarget::SLOW_FRACTION = 0.8;
+const double RenderTarget::FAST_FRACTION = 0.4;
+const int RenderTarget::FAST_SECONDS = 3;
+
+bool RenderTarget::automatic = true;
+int RenderTarget::profile = PROFILE_MEDIUM;
+int RenderTarget::fast_seconds = 0;
+bool RenderTarget::settling = false;
+double RenderTarget::measured_ms[TOTAL_PROFILES] = { -1., -1., -1. };
+
+int RenderTarget::window_width = 0;
+int RenderTarget::window_height = 0;
+int RenderTarget::width = 0;
+int RenderTarget::height = 0;
+int RenderTarget::samples = 0;
+
+const GLchar* RenderTarget::vertex_shader =
+            "#version 150 core\n"
+                    "in vec2 position;"
+                    "out vec2 f_uv;"
+                    "void main()"
+                    "{"
+                    "    f_uv = position * 0.5 + 0.5;"
+                    "    gl_Position = vec4(position, 0.0, 1.0);"
+                    "}";
+
+// Single sampled targets go through the bilinear sampler. Multisampled ones
+// are resolved here: the samples of the four nearest texels are averaged
+// and those four colors are blended bilinearly.
+const GLchar* RenderTarget::fragment_shader =
+        "#version 150 core\n"
+                "in vec2 f_uv;"
+                "out vec4 outColor;"
+                "uniform sampler2D image;"
+                "uniform sampler2DMS image_ms;"
+                "uniform int samples;"
+                "uniform ivec2 size;"
+                "uniform bool upscale;"
+                "vec4 resolve(ivec2 p)"
+                "{"
+                "    p = clamp(p, ivec2(0), size - 1);"
+                "    vec4 c = vec4(0.0);"
+                "    for (int i = 0; i < samples; ++i) c += texelFetch(image_ms, p, i);"
+                "    return c / float(samples);"
+                "}"
+                "void main()"
+                "{"
+                "    if (samples == 0) {"
+                "        outColor = texture(image, f_uv);"
+                "        return;"
+                "    }"
+                "    if (!upscale) {"
+                "        outColor = resolve(ivec2(gl_FragCoord.xy));"
+                "        return;"
+                "    }"
+                "    vec2 t = f_uv * vec2(size) - 0.5;"
+                "    ivec2 p = ivec2(floor(t));"
+                "    vec2 f = t - floor(t);"
+                "    outColor = mix(mix(resolve(p), resolve(p + ivec2(1, 0)), f.x),"
+                "                   mix(resolve(p + ivec2(0, 1)), resolve(p + ivec2(1, 1)), f.x), f.y);"
+                "}";
+
+Program RenderTarget::program;
+VertexArrayObject RenderTarget::VAO;
+VertexBufferObject RenderTarget::VBO;
+
+GLuint RenderTarget::fbo = 0;
+Texture RenderTarget::color;
+
+void RenderTarget::init(int w, int h) {
+    window_width = w;
+    window_height = h;
+
+    // One triangle covering the whole viewport
+    Eigen::MatrixXf V(2, 3);
+    V << -1., 3., -1.,
+         -1., -1., 3.;
+
+    program.init(vertex_shader, fragment_shader, "outColor");
+    program.bind();
+    glUniform1i(program.uniform("image"), 0);
+    glUniform1i(program.uniform("image_ms"), 1);
+
+    VAO.init();
+    VAO.bind();
+    VBO.init();
+    VBO.update(V);
+    program.bindVertexAttribArray("position", VBO);
+
+    create();
+}
+
+void RenderTarget::teardown() {
+    destroy();
+    program.free();
+    VAO.free();
+    VBO.free();
+}
+
+void RenderTarget::resize(int w, int h) {
+    if (w == window_width && h == window_height) {
+        return;
+    }
+    window_width = w;
+    window_height = h;
+    for (int p = 0; p < TOTAL_PROFILES; ++p) {
+        measured_ms[p] = -1.;
+    }
+    destroy();
+    create();
+}
+
+bool RenderTarget::select(const char* name) {
+    if (strcmp(name, "auto") == 0) {
+        automatic = true;
+        return true;
+    }
+    for (int p = 0; p < TOTAL_PROFILES; ++p) {
+        // Profile names are upper case for the HUD font
+        bool match = strlen(name) == strlen(profiles[p].name);
+        for (int i = 0; match && name[i]; ++i) {
+            match = toupper(name[i]) == profiles[p].name[i];
+        }
+        if (match) {
+            automatic = false;
+            set_profile(p);
+            return true;
+        }
+    }
+    return false;
+}
+
+void RenderTarget::set_profile(int p) {
+    p = std::max(0, std::min(p, TOTAL_PROFILES - 1));
+    fast_seconds = 0;
+    settling = true;
+    if (p == profile) {
+        return;
+    }
+    profile = p;
+    if (window_width > 0) {
+        destroy();
+        create();
+    }
+}
+
+void RenderTarget::cycle() {
+    if (automatic) {
+        automatic = false;
+        set_profile(PROFILE_LOW);
+    } else if (profile == TOTAL_PROFILES - 1) {
+        automatic = true;
+        fast_seconds = 0;
+    } else {
+        set_profile(profile + 1);
+    }
+}
+
+void RenderTarget::adapt(double frame_avg_ms, double period_ms) {
+    if (!automatic) {
+        return;
+    }
+    if (settling) {
+        settling = false;
+        return;
+    }
+    measured_ms[profile] = frame_avg_ms;
+
+    double slow_ms = SLOW_FRACTION * period_ms;
+    if (frame_avg_ms > slow_ms) {
+        fast_seconds = 0;
+        int p = profile - 1;
+        if (p >= 0 && (measured_ms[p] < 0. || measured_ms[p] < frame_avg_ms)) {
+            printf("quality: %.2f ms/frame, down to %s\n", frame_avg_ms, profiles[p].name);
+            set_profile(p);
+        }
+    } else if (frame_avg_ms < FAST_FRACTION * period_ms) {
+        int p = profile + 1;
+        if (++fast_seconds >= FAST_SECONDS && p < TOTAL_PROFILES &&
+            (measured_ms[p] < 0. || measured_ms[p] < slow_ms)) {
+            printf("quality: %.2f ms/frame, up to %s\n", frame_avg_ms, profiles[p].name);
+            set_profile(p);
+        }
+    } else {
+        fast_seconds = 0;
+    }
+}
+
+void RenderTarget::create() {
+    const Profile& pr = profiles[profile];
+    width = std::max(1, (int)(window_width * pr.scale + 0.5f));
+    height = std::max(1, (int)(window_height * pr.scale + 0.5f));
+
+    GLint max_samples = 0;
+    glGetIntegerv(GL_MAX_SAMPLES, &max_samples);
+    samples = std::min(pr.samples, (int)max_samples);
+    if (width == window_width && height == window_height && samples == 0) {
+        return;
+    }
+
+    // The two samplers of the present shader sit on units 0 and 1
+    color.init();
+    GLenum target = samples > 0 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
+    glActiveTexture(samples > 0 ? GL_TEXTURE1 : GL_TEXTURE0);
+    glBindTexture(target, color.id);
+    if (samples > 0) {
+        glTexImage2DMultisample(target, samples, GL_RGBA8, width, height, GL_TRUE);
+    } else {
+        glTexImage2D(target, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    color.width = width;
+    color.height = height;
+    glBindTexture(target, 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, target, color.id, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Error: incomplete offscreen framebuffer\n");
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    program.bind();
+    glUniform1i(program.uniform("samples"), samples);
+    glUniform2i(program.uniform("size"), width, height);
+    glUniform1i(program.uniform("upscale"), width != window_width || height != window_height);
+    check_gl_error();
+}
+
+void RenderTarget::destroy() {
+    if (fbo) {
+        glDeleteFramebuffers(1, &fbo);
+        color.free();
+    }
+    fbo = 0;
+}
+
+void RenderTarget::begin() {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, width, height);
+}
+
+void RenderTarget::present() {
+    if (fbo == 0) {
+        return;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, window_width, window_height);
+
+    VAO.bind();
+    program.bind();
+    if (samples > 0) {
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, color.id);
+        glActiveTexture(GL_TEXTURE0);
+    } else {
+        color.bind();
+    }
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    check_gl_error();
+}
@@ -0,0 +1,85 @@
+#ifndef RENDER_TARGET_H
+#define RENDER_TARGET_H
+
+#include "Helpers.h"
+
+// Offscreen framebuffer the board and particles are drawn into.
+// Its size is the window size times the render scale of the current quality
+// profile, optionally multisampled. present() draws it over the window with
+// one fullscreen triangle that resolves the samples and upscales in the same
+// pass; the HUD is drawn afterwards at the native resolution. A profile at
+// full scale without samples skips the offscreen target altogether.
+class RenderTarget {
+public:
+    enum PROFILE {
+        PROFILE_LOW,
+        PROFILE_MEDIUM,
+        PROFILE_HIGH,
+        TOTAL_PROFILES
+    };
+
+    struct Profile {
+        const char* name;
+        float scale;
+        int samples;
+    };
+
+    static const Profile profiles[TOTAL_PROFILES];
+
+    // Automatic mode steps down above the first fraction of the frame
+    // period and back up after a few seconds below the second one
+    static const double SLOW_FRACTION;
+    static const double FAST_FRACTION;
+    static const int FAST_SECONDS;
+
+    static bool automatic;
+    static int profile;
+    static int fast_seconds;
+    // The first measurement after a switch still mixes in the old profile
+    static bool settling;
+    // Last average frame time seen with each profile, negative if never
+    // tried. A lower profile is not always cheaper: the extra fullscreen
+    // pass can cost more than the pixels it saves.
+    static double measured_ms[TOTAL_PROFILES];
+
+    static int window_width;
+    static int window_height;
+    // Size and sample count actually allocated
+    static int width;
+    static int height;
+    static int samples;
+
+    static const GLchar* vertex_shader;
+    static const GLchar* fragment_shader;
+    static Program program;
+    static VertexArrayObject VAO;
+    static VertexBufferObject VBO;
+
+    static GLuint fbo;
+    // GL_TEXTURE_2D, or GL_TEXTURE_2D_MULTISAMPLE when samples > 0
+    static Texture color;
+
+    static void init(int w, int h);
+    static void teardown();
+    static void resize(int w, int h);
+
+    // Accepts "low", "medium", "high" or "auto"
+    static bool select(const char* name);
+    static void set_profile(int p);
+    // Moves through low, medium, high and automatic
+    static void cycle();
+
+    // Binds the offscreen framebuffer and its viewport
+    static void begin();
+    // Resolves and scales into the window, which stays bound afterwards
+    static void present();
+
+    // Called about once a second with the recent average frame time
+    static void adapt(double frame_avg_ms, double period_ms);
+
+private:
+    static void create();
+    static void destroy();
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef SHAPES_H
+#define SHAPES_H
+
+// The board and the pieces, without anything OpenGL, so code that only
+// reasons about positions can use them on its own
+
+const int TOTAL_ROWS = 20;
+const int TOTAL_COLS = 20;
+
+enum SHAPE_TYPE {
+    TETRIS_LSHAPE,
+    TETRIS_GAMMASHAPE,
+    TETRIS_STRIPSHAPE,
+    TETRIS_TSHAPE,
+    TETRIS_SQUARESHAPE,
+    TETRIS_LEFTNSHAPE,
+    TETRIS_RIGHTNSHAPE,
+    TETRIS_TOTALSHAPE
+};
+
+enum SHAPE_SUBTYPE {
+    LSHAPE_DOWN,
+    LSHAPE_LEFT,
+    LSHAPE_UP,
+    LSHAPE_RIGHT,
+    GAMMASHAPE_DOWN,
+    GAMMASHAPE_RIGHT,
+    GAMMASHAPE_UP,
+    GAMMASHAPE_LEFT,
+    STRIPSHAPE_LANDSCAPE,
+    STRIPSHAPE_PORTRAIT,
+    TSHAPE_DOWN,
+    TSHAPE_LEFT,
+    TSHAPE_UP,
+    TSHAPE_RIGHT,
+    LEFTNSHAPE_VERTICAL,
+    LEFTNSHAPE_HORIZONTAL,
+    RIGHTNSHAPE_VERTICAL,
+    RIGHTNSHAPE_HORIZONTAL
+};
+
+struct coordinate {
+    int x;
+    int y;
+    coordinate(): x(0), y(0) {}
+    coordinate(int _x, int _y): x(_x), y(_y) {}
+
+    void move_down() {
+        ++x;
+    }
+
+    void move_left() {
+        --y;
+    }
+
+    void move_right() {
+        ++y;
+    }
+};
+
+const unsigned int SQUARE_PER_SHAPE = 4;
+
+#endif
@@ -0,0 +1,116 @@
+#include "TerminalRenderer.h"
+
+namespace {
+
+// Background color of every cell kind
+const char* CELL_SGR[] = { "\x1b[0m", "\x1b[47m", "\x1b[46m" };
+
+// Row and column of the top left cell, inside the border
+const int ORIGIN_ROW = 2;
+const int ORIGIN_COL = 3;
+
+}
+
+TerminalRenderer::TerminalRenderer(int rows, int cols, FILE* out):
+        frames(0), bytes_total(0), bytes_last(0),
+        rows(rows), cols(cols), out(out),
+        cells(rows * cols, CELL_EMPTY), shown(rows * cols, CELL_EMPTY),
+        has_shown(false), cursor_row(-1), cursor_col(-1), color(-1) {
+}
+
+TerminalRenderer::~TerminalRenderer() {
+    if (!has_shown) {
+        return;
+    }
+    // Leave the cursor below the board with default colors
+    buf.clear();
+    move_to(ORIGIN_ROW + rows + 1, 1);
+    buf += "\x1b[0m\x1b[?25h\n";
+    fwrite(buf.data(), 1, buf.size(), out);
+    fflush(out);
+}
+
+void TerminalRenderer::set_cell(int row, int col, CELL cell) {
+    cells[row * cols + col] = cell;
+}
+
+void TerminalRenderer::invalidate() {
+    has_shown = false;
+}
+
+void TerminalRenderer::move_to(int row, int col) {
+    if (row == cursor_row && col == cursor_col) {
+        return;
+    }
+    char seq[32];
+    if (row == cursor_row && col > cursor_col && col - cursor_col < 1000) {
+        // Cursor forward is shorter than an absolute position
+        snprintf(seq, sizeof(seq), "\x1b[%dC", col - cursor_col);
+    } else {
+        snprintf(seq, sizeof(seq), "\x1b[%d;%dH", row, col);
+    }
+    buf += seq;
+    cursor_row = row;
+    cursor_col = col;
+}
+
+void TerminalRenderer::put(const std::string& text) {
+    buf += text;
+    cursor_col += text.size();
+}
+
+void TerminalRenderer::set_color(CELL cell) {
+    if (color == cell) {
+        return;
+    }
+    buf += CELL_SGR[cell];
+    color = cell;
+}
+
+size_t TerminalRenderer::present() {
+    buf.clear();
+
+    if (!has_shown) {
+        // Clear the screen, hide the cursor and draw the static border
+        buf += "\x1b[0m\x1b[2J\x1b[?25l";
+        cursor_row = cursor_col = color = -1;
+        set_color(CELL_EMPTY);
+        std::string edge(2 * cols + 2, '-');
+        move_to(ORIGIN_ROW - 1, ORIGIN_COL - 1);
+        put(edge);
+        for (int r = 0; r < rows; ++r) {
+            move_to(ORIGIN_ROW + r, ORIGIN_COL - 1);
+            put("|");
+            move_to(ORIGIN_ROW + r, ORIGIN_COL + 2 * cols);
+            put("|");
+        }
+        move_to(ORIGIN_ROW + rows, ORIGIN_COL - 1);
+        put(edge);
+        for (size_t i = 0; i < shown.size(); ++i) {
+            shown[i] = CELL_EMPTY;
+        }
+        has_shown = true;
+    }
+
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < cols; ++c) {
+            int i = r * cols + c;
+            if (cells[i] == shown[i]) {
+                continue;
+            }
+            move_to(ORIGIN_ROW + r, ORIGIN_COL + 2 * c);
+            set_color(static_cast<CELL>(cells[i]));
+            put("  ");
+            shown[i] = cells[i];
+        }
+    }
+
+    bytes_last = buf.size();
+    if (bytes_last > 0) {
+        fwrite(buf.data(), 1, buf.size(), out);
+        fflush(out);
+    }
+    bytes_total += bytes_last;
+    ++frames;
+    return bytes_last;
+}
@@ -0,0 +1,56 @@
+#ifndef TERMINAL_RENDERER_H
+#define TERMINAL_RENDERER_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Draws the board on an ANSI terminal, two characters per cell.
+// The caller fills in the cells of a frame and present() sends only the
+// cells that differ from the previously emitted frame, jumping between them
+// with cursor motion sequences. Plain C++ on purpose: no GL or GLFW, so it
+// also works for bots and servers without a display.
+class TerminalRenderer {
+public:
+    enum CELL {
+        CELL_EMPTY,
+        CELL_BOARD,
+        CELL_PIECE
+    };
+
+    TerminalRenderer(int rows, int cols, FILE* out);
+    ~TerminalRenderer();
+
+    void set_cell(int row, int col, CELL cell);
+
+    // Writes the changes since the last frame, returns the bytes sent
+    size_t present();
+
+    // Forgets what the terminal shows, the next present() redraws everything
+    void invalidate();
+
+    long long int frames;
+    long long int bytes_total;
+    size_t bytes_last;
+
+private:
+    void move_to(int row, int col);
+    // Appends printable text, which moves the cursor right
+    void put(const std::string& text);
+    void set_color(CELL cell);
+
+    int rows;
+    int cols;
+    FILE* out;
+    std::vector<unsigned char> cells;
+    std::vector<unsigned char> shown;
+    bool has_shown;
+    // Terminal state after the bytes already in buf, 1-based like ANSI;
+    // -1 when unknown
+    int cursor_row;
+    int cursor_col;
+    int color;
+    std::string buf;
+};
+
+#endif
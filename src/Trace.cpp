@@ -0,0 +1,127 @@
+#ifdef TETRIS_TRACE
+
+#include "Trace.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Event {
+    const char* name;
+    int64_t start_ns;
+    int64_t end_ns;
+};
+
+// Each thread appends to its own ring without synchronization and keeps the
+// newest EVENTS_PER_THREAD zones, the ones around a hitch at the end of a run
+const size_t EVENTS_PER_THREAD = 1 << 16;
+
+struct ThreadBuffer {
+    Event events[EVENTS_PER_THREAD];
+    size_t count;
+    int tid;
+    const char* name;
+};
+
+// Taken once per thread, when it records its first zone, and by flush()
+std::mutex registry_mutex;
+std::vector<ThreadBuffer*> registry;
+std::string output_path;
+int64_t origin_ns = 0;
+
+thread_local ThreadBuffer* local_buffer = NULL;
+
+ThreadBuffer* thread_buffer() {
+    if (local_buffer == NULL) {
+        local_buffer = new ThreadBuffer();
+        local_buffer->count = 0;
+        local_buffer->name = NULL;
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        local_buffer->tid = (int)registry.size() + 1;
+        registry.push_back(local_buffer);
+    }
+    return local_buffer;
+}
+
+}
+
+std::atomic<bool> Trace::enabled(false);
+
+int64_t Trace::now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Trace::init() {
+    const char* path = getenv("TETRIS_TRACE");
+    if (path == NULL) {
+        return;
+    }
+    output_path = path;
+    origin_ns = now_ns();
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+void Trace::name_thread(const char* name) {
+    if (enabled.load(std::memory_order_relaxed)) {
+        thread_buffer()->name = name;
+    }
+}
+
+void Trace::record(const char* name, int64_t start_ns, int64_t end_ns) {
+    ThreadBuffer* buffer = thread_buffer();
+    Event& event = buffer->events[buffer->count % EVENTS_PER_THREAD];
+    event.name = name;
+    event.start_ns = start_ns;
+    event.end_ns = end_ns;
+    ++buffer->count;
+}
+
+void Trace::flush() {
+    if (!enabled.exchange(false)) {
+        return;
+    }
+    FILE* out = fopen(output_path.c_str(), "w");
+    if (out == NULL) {
+        fprintf(stderr, "Can not write TETRIS_TRACE %s\n", output_path.c_str());
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    long long int total = 0;
+    long long int dropped = 0;
+    bool first = true;
+    fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    for (size_t t = 0; t < registry.size(); ++t) {
+        const ThreadBuffer* buffer = registry[t];
+        if (buffer->name != NULL) {
+            fprintf(out, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+                         "\"args\": {\"name\": \"%s\"}}", first ? "" : ",\n", buffer->tid,
+                    buffer->name);
+            first = false;
+        }
+        size_t begin = buffer->count > EVENTS_PER_THREAD ? buffer->count - EVENTS_PER_THREAD : 0;
+        dropped += begin;
+        for (size_t i = begin; i < buffer->count; ++i) {
+            const Event& event = buffer->events[i % EVENTS_PER_THREAD];
+            // Chrome trace timestamps are microseconds
+            fprintf(out, "%s{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+                         "\"ts\": %.3f, \"dur\": %.3f}", first ? "" : ",\n", event.name,
+                    buffer->tid, (event.start_ns - origin_ns) / 1000.0,
+                    (event.end_ns - event.start_ns) / 1000.0);
+            first = false;
+            ++total;
+        }
+    }
+    fprintf(out, "\n]}\n");
+    fclose(out);
+    printf("Trace: %lld zones written to %s, %lld older ones overwritten\n", total,
+           output_path.c_str(), dropped);
+}
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Scoped trace zones written as a Chrome trace-event file, which opens in
+// Perfetto or chrome://tracing. Built only with -DTETRIS_TRACE=ON, otherwise
+// TRACE_ZONE expands to nothing. At run time zones are recorded only while
+// TETRIS_TRACE names an output file; when it does not, a zone costs one
+// load and branch.
+//
+//   void check_grid() {
+//       TRACE_ZONE("check_grid");
+//       ...
+//   }
+
+#ifdef TETRIS_TRACE
+
+#include <atomic>
+#include <cstdint>
+
+class Trace {
+public:
+    // Opens the output named by TETRIS_TRACE, if any, and starts recording
+    static void init();
+    // Names the calling thread in the trace
+    static void name_thread(const char* name);
+    // Writes every thread's events; the other threads must have stopped
+    static void flush();
+
+    static std::atomic<bool> enabled;
+
+    static int64_t now_ns();
+    static void record(const char* name, int64_t start_ns, int64_t end_ns);
+
+    class Zone {
+    public:
+        explicit Zone(const char* zone_name)
+            : name(enabled.load(std::memory_order_relaxed) ? zone_name : 0),
+              start_ns(name != 0 ? now_ns() : 0) {}
+        ~Zone() {
+            if (name != 0) {
+                record(name, start_ns, now_ns());
+            }
+        }
+
+    private:
+        const char* name;
+        int64_t start_ns;
+    };
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_ZONE(name) Trace::Zone TRACE_CONCAT(trace_zone_, __LINE__)(name)
+#define TRACE_INIT() Trace::init()
+#define TRACE_THREAD(name) Trace::name_thread(name)
+#define TRACE_FLUSH() Trace::flush()
+
+#else
+
+#define TRACE_ZONE(name) do {} while (0)
+#define TRACE_INIT() do {} while (0)
+#define TRACE_THREAD(name) do {} while (0)
+#define TRACE_FLUSH() do {} while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,163 @@
+#include "TranspositionTable.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#ifdef _MSC_VER
+#  include <malloc.h>
+#endif
+
+const int TranspositionTable::BUCKET_ENTRIES;
+
+namespace {
+
+// data is, from the top bit down, the generation of the write (23 bits),
+// whether there is a value (1), the flags (8) and the value's bits (32).
+// Every written entry has a value or a flag, so only empty ones are 0,
+// whatever the generation has wrapped to.
+const int FLAG_SHIFT = 32;
+const uint64_t FLAG_MASK = 0xFFull << FLAG_SHIFT;
+const uint64_t HAS_VALUE = 1ull << 40;
+const int GENERATION_SHIFT = 41;
+const uint32_t GENERATION_MASK = (1u << 23) - 1;
+
+inline uint64_t pack(uint32_t generation, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return ((uint64_t)(generation & GENERATION_MASK) << GENERATION_SHIFT) | HAS_VALUE | bits;
+}
+
+inline float unpack(uint64_t data) {
+    uint32_t bits = (uint32_t)data;
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline uint32_t generation_of(uint64_t data) {
+    return (uint32_t)(data >> GENERATION_SHIFT);
+}
+
+inline uint32_t flags_of(uint64_t data) {
+    return (uint32_t)((data & FLAG_MASK) >> FLAG_SHIFT);
+}
+
+}
+
+TranspositionTable::TranspositionTable(size_t megabytes) : generation(1) {
+    size_t count = 1;
+    while (count * 2 * sizeof(Bucket) <= megabytes * 1024 * 1024) {
+        count *= 2;
+    }
+    // new does not align to a cache line before C++17
+    void* memory = NULL;
+#ifdef _MSC_VER
+    memory = _aligned_malloc(count * sizeof(Bucket), sizeof(Bucket));
+#else
+    if (posix_memalign(&memory, sizeof(Bucket), count * sizeof(Bucket)) != 0) {
+        memory = NULL;
+    }
+#endif
+    if (memory == NULL) {
+        throw std::bad_alloc();
+    }
+    buckets = static_cast<Bucket*>(memory);
+    for (size_t b = 0; b < count; ++b) {
+        new (&buckets[b]) Bucket();
+    }
+    bucket_mask = count - 1;
+    clear();
+}
+
+TranspositionTable::~TranspositionTable() {
+    for (size_t b = 0; b <= bucket_mask; ++b) {
+        buckets[b].~Bucket();
+    }
+#ifdef _MSC_VER
+    _aligned_free(buckets);
+#else
+    free(buckets);
+#endif
+}
+
+bool TranspositionTable::probe(uint64_t key, float* value) const {
+    const Bucket& bucket = buckets[key & bucket_mask];
+    for (int i = 0; i < BUCKET_ENTRIES; ++i) {
+        uint64_t data = bucket.entries[i].data.load(std::memory_order_relaxed);
+        uint64_t check = bucket.entries[i].check.load(std::memory_order_relaxed);
+        if ((check ^ data) == key && (data & HAS_VALUE)) {
+            *value = unpack(data);
+            return true;
+        }
+    }
+    return false;
+}
+
+int TranspositionTable::find_slot(const Bucket& bucket, uint64_t key, uint64_t* found) const {
+    int victim = 0;
+    uint32_t oldest = UINT32_MAX;
+    *found = 0;
+    for (int i = 0; i < BUCKET_ENTRIES; ++i) {
+        uint64_t data = bucket.entries[i].data.load(std::memory_order_relaxed);
+        uint64_t check = bucket.entries[i].check.load(std::memory_order_relaxed);
+        if (data == 0) {
+            return i;
+        }
+        if ((check ^ data) == key) {
+            *found = data;
+            return i;
+        }
+        if (generation_of(data) < oldest) {
+            oldest = generation_of(data);
+            victim = i;
+        }
+    }
+    return victim;
+}
+
+void TranspositionTable::store(uint64_t key, float value) {
+    Bucket& bucket = buckets[key & bucket_mask];
+    uint64_t old;
+    int victim = find_slot(bucket, key, &old);
+    uint64_t data = pack(generation.load(std::memory_order_relaxed), value) | (old & FLAG_MASK);
+    bucket.entries[victim].data.store(data, std::memory_order_relaxed);
+    bucket.entries[victim].check.store(key ^ data, std::memory_order_relaxed);
+}
+
+uint32_t TranspositionTable::mark(uint64_t key, uint32_t flags) {
+    flags &= 0xFF;
+    Bucket& bucket = buckets[key & bucket_mask];
+    uint64_t old;
+    int victim = find_slot(bucket, key, &old);
+    uint32_t had = flags_of(old);
+    if ((had & flags) == flags) {
+        return had;
+    }
+    uint64_t now = generation.load(std::memory_order_relaxed) & GENERATION_MASK;
+    uint64_t data = (now << GENERATION_SHIFT) | (old & (HAS_VALUE | 0xFFFFFFFFull)) |
+                    ((uint64_t)(had | flags) << FLAG_SHIFT);
+    bucket.entries[victim].data.store(data, std::memory_order_relaxed);
+    bucket.entries[victim].check.store(key ^ data, std::memory_order_relaxed);
+    return had;
+}
+
+void TranspositionTable::new_search() {
+    generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TranspositionTable::clear() {
+    for (size_t b = 0; b <= bucket_mask; ++b) {
+        for (int i = 0; i < BUCKET_ENTRIES; ++i) {
+            buckets[b].entries[i].check.store(0, std::memory_order_relaxed);
+            buckets[b].entries[i].data.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+size_t TranspositionTable::memory_bytes() const {
+    return (bucket_mask + 1) * sizeof(Bucket);
+}
+
+size_t TranspositionTable::capacity() const {
+    return (bucket_mask + 1) * BUCKET_ENTRIES;
+}
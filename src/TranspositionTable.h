@@ -0,0 +1,72 @@
+#ifndef TRANSPOSITION_TABLE_H
+#define TRANSPOSITION_TABLE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Fixed-size hash table from a 64-bit Zobrist key to a float and eight
+// flag bits, shared by every thread of every search without locks. Keys
+// map to a bucket of four entries on one cache line. An entry stores its
+// data and the key XOR-ed with the data in two words; a reader that sees
+// the halves of two different writes gets a key that does not match and
+// treats it as a miss, so a racing write can lose an entry or a flag but
+// never return a wrong value.
+//
+// A key's flags share its entry with its value and can be set before the
+// value is, so marking a key never evicts another key's value to make room
+// for a second entry.
+//
+// A write replaces the entry with the same key, else an empty one, else
+// the one written longest ago, counted in searches (see new_search()).
+class TranspositionTable {
+public:
+    // Rounded down to a power of two buckets, at least one
+    explicit TranspositionTable(size_t megabytes);
+    ~TranspositionTable();
+
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+    // Starts loading key's bucket, to probe or store it a little later
+    void prefetch(uint64_t key) const {
+#if defined(__GNUC__)
+        __builtin_prefetch(&buckets[key & bucket_mask]);
+#else
+        (void)key;
+#endif
+    }
+    bool probe(uint64_t key, float* value) const;
+    // Keeps the flags key already has
+    void store(uint64_t key, float value);
+    // Sets flags, the low 8 bits, on key and returns the ones it had
+    // before, 0 when key was not in the table
+    uint32_t mark(uint64_t key, uint32_t flags);
+
+    // Ages everything stored so far, so it is replaced first
+    void new_search();
+    void clear();
+
+    size_t memory_bytes() const;
+    size_t capacity() const;
+
+private:
+    struct Entry {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+    static const int BUCKET_ENTRIES = 4;
+    struct alignas(64) Bucket {
+        Entry entries[BUCKET_ENTRIES];
+    };
+
+    // The entry of bucket to write key to; *found is what it holds when it
+    // is key's, else 0
+    int find_slot(const Bucket& bucket, uint64_t key, uint64_t* found) const;
+
+    Bucket* buckets;
+    size_t bucket_mask;
+    std::atomic<uint32_t> generation;
+};
+
+#endif
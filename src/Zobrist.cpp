@@ -0,0 +1,112 @@
+#include "Zobrist.h"
+
+namespace {
+
+// Rows are hashed a byte of columns at a time: each table entry is the
+// XOR of the cell keys of the bits set in its index
+const int ROW_BYTES = (TOTAL_COLS + 7) / 8;
+
+struct Keys {
+    uint64_t cells[TOTAL_ROWS][TOTAL_COLS];
+    uint64_t pieces[TETRIS_TOTALSHAPE][TOTAL_ROWS][TOTAL_COLS];
+    uint64_t rows[TOTAL_ROWS][ROW_BYTES][256];
+
+    Keys() {
+        uint64_t state = 0x9e3779b97f4a7c15ull;
+        for (int r = 0; r < TOTAL_ROWS; ++r) {
+            for (int c = 0; c < TOTAL_COLS; ++c) {
+                cells[r][c] = split_mix(&state);
+            }
+        }
+        for (int t = 0; t < TETRIS_TOTALSHAPE; ++t) {
+            for (int r = 0; r < TOTAL_ROWS; ++r) {
+                for (int c = 0; c < TOTAL_COLS; ++c) {
+                    pieces[t][r][c] = split_mix(&state);
+                }
+            }
+        }
+        for (int r = 0; r < TOTAL_ROWS; ++r) {
+            for (int b = 0; b < ROW_BYTES; ++b) {
+                for (int v = 0; v < 256; ++v) {
+                    uint64_t key = 0;
+                    for (int bit = 0; bit < 8 && b * 8 + bit < TOTAL_COLS; ++bit) {
+                        if (v & (1 << bit)) {
+                            key ^= cells[r][b * 8 + bit];
+                        }
+                    }
+                    rows[r][b][v] = key;
+                }
+            }
+        }
+    }
+
+    static uint64_t split_mix(uint64_t* state) {
+        uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+} keys;
+
+}
+
+uint64_t Zobrist::cell(int row, int col) {
+    return keys.cells[row][col];
+}
+
+uint64_t Zobrist::row(int row, uint32_t bits) {
+    uint64_t key = 0;
+    for (int b = 0; b < ROW_BYTES; ++b) {
+        key ^= keys.rows[row][b][(bits >> (b * 8)) & 255];
+    }
+    return key;
+}
+
+uint64_t Zobrist::board(const Bitboard& board) {
+    uint64_t key = 0;
+    for (int r = 0; r < TOTAL_ROWS; ++r) {
+        if (board.rows[r] != 0) {
+            key ^= row(r, board.rows[r]);
+        }
+    }
+    return key;
+}
+
+uint64_t Zobrist::cells(const coordinate cells[SQUARE_PER_SHAPE]) {
+    uint64_t key = 0;
+    for (unsigned int i = 0; i < SQUARE_PER_SHAPE; ++i) {
+        key ^= keys.cells[cells[i].x][cells[i].y];
+    }
+    return key;
+}
+
+uint64_t Zobrist::piece(SHAPE_TYPE type, const coordinate cells[SQUARE_PER_SHAPE]) {
+    uint64_t key = 0;
+    for (unsigned int i = 0; i < SQUARE_PER_SHAPE; ++i) {
+        key ^= keys.pieces[type][cells[i].x][cells[i].y];
+    }
+    return key;
+}
+
+uint64_t Zobrist::piece_move(SHAPE_TYPE type, const coordinate cells[SQUARE_PER_SHAPE],
+                             int dr, int dc) {
+    uint64_t key = 0;
+    for (unsigned int i = 0; i < SQUARE_PER_SHAPE; ++i) {
+        int r = cells[i].x;
+        int c = cells[i].y;
+        // Another cell moves onto this one, or this one onto another
+        bool refilled = false;
+        bool already = false;
+        for (unsigned int j = 0; j < SQUARE_PER_SHAPE; ++j) {
+            refilled |= cells[j].x + dr == r && cells[j].y + dc == c;
+            already |= cells[j].x == r + dr && cells[j].y == c + dc;
+        }
+        if (!refilled) {
+            key ^= keys.pieces[type][r][c];
+        }
+        if (!already) {
+            key ^= keys.pieces[type][r + dr][c + dc];
+        }
+    }
+    return key;
+}
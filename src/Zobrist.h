@@ -0,0 +1,28 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include "Placements.h"
+
+#include <cstdint>
+
+// 64-bit Zobrist keys: a board hashes to the XOR of the keys of its filled
+// cells and a falling piece to the XOR of its own per-type cell keys, so
+// both can be updated by XOR-ing out what changed and XOR-ing in what
+// replaced it. Keys come from a fixed seed and are the same every run.
+class Zobrist {
+public:
+    static uint64_t cell(int row, int col);
+    // A row holding bits, bit c being column c
+    static uint64_t row(int row, uint32_t bits);
+    static uint64_t board(const Bitboard& board);
+    // The board cells a placed piece fills
+    static uint64_t cells(const coordinate cells[SQUARE_PER_SHAPE]);
+    // A falling piece, which hashes apart from the same cells on the board
+    static uint64_t piece(SHAPE_TYPE type, const coordinate cells[SQUARE_PER_SHAPE]);
+    // What moving a falling piece by (dr, dc) changes in its hash, taken
+    // before the move: only the cells it leaves and the cells it enters
+    static uint64_t piece_move(SHAPE_TYPE type, const coordinate cells[SQUARE_PER_SHAPE],
+                               int dr, int dc);
+};
+
+#endif
@@ -2,13 +2,41 @@
 
 // OpenGL Helpers to reduce the clutter
 #include "Helpers.h"
+#include "Hud.h"
+#include "Particles.h"
+#include "GpuTimers.h"
+#include "RenderTarget.h"
+#include "TerminalRenderer.h"
+#include "Handoff.h"
+#include "Histogram.h"
+#include "Trace.h"
+#include "Log.h"
+#include "Bot.h"
+#include "BeamSearch.h"
+#include "MonteCarlo.h"
+#include "TranspositionTable.h"
+#include "Zobrist.h"
+#include "JobSystem.h"
 
 // GLFW is necessary to handle the OpenGL context
 #include <GLFW/glfw3.h>
+#ifdef TETRIS_HEADLESS
+// The null platform lets us feed input without a keyboard
+#  define GLFW_EXPOSE_NATIVE_NULL
+#  define GLFW_EXPOSE_NATIVE_EGL
+#  include <GLFW/glfw3native.h>
+#endif
 #include <iostream>
 #include <cstdlib>
+#include <csignal>
+#include <cstring>
 #include <ctime>
+#include <algorithm>
 #include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 // Linear Algebra Library
 #include <Eigen/Core>
 #include <Eigen/Dense>
@@ -21,8 +49,6 @@
 #include <sys/wait.h>
 
 const int TOTAL_SQUARE_NUM = 400;
-const int TOTAL_ROWS = 20;
-const int TOTAL_COLS = 20;
 // Contains the vertex for Bezier curves
 const double bc_step = 0.001;
 const int BC_VERTICE_NUM = (int)((double)1.0 / (double)bc_step);
@@ -31,60 +57,661 @@ const double EPSILON = 0.00000001;
 const double PI  =3.141592653589793238463;
 
 bool board_grid[TOTAL_ROWS][TOTAL_COLS];
+// Zobrist::board() of board_grid, kept up to date by persist() and line
+// clears instead of being recomputed
+uint64_t board_hash = 0;
+// board_grid by row and by column: bit c of board_row_bits[r] and bit r of
+// board_col_bits[c] are board_grid[r][c]. persist() and line clears keep
+// them up to date, and drops and slides read their distances off them.
+uint32_t board_row_bits[TOTAL_ROWS];
+uint32_t board_col_bits[TOTAL_COLS];
 bool board_grid_backup[TOTAL_ROWS][TOTAL_COLS];
 TetrisShape *pTshape = NULL;
 bool is_ending = false;
 long long int total_smashed = 1;
 
+// Shown on the HUD
+long long int score = 0;
+long long int total_lines = 0;
+int level = 0;
+SHAPE_TYPE next_type = TETRIS_TOTALSHAPE;
+// Points for clearing 1, 2, 3 or 4 rows at once, multiplied by level + 1
+const int LINE_SCORES[SQUARE_PER_SHAPE + 1] = {0, 40, 100, 300, 1200};
+// Frame times of the last second, for the HUD average and maximum
+const int FRAME_HISTORY = 60;
+double frame_ms_history[FRAME_HISTORY];
+// Whole-run distributions, written to TETRIS_STATS.json/.csv at exit.
+// The frame and swap histograms are recorded by the main thread, tick and
+// input (key event to the tick that applies it) by the simulation thread.
+Histogram frame_histogram("frame_ms");
+Histogram swap_histogram("swap_ms");
+Histogram tick_histogram("tick_ms");
+Histogram input_histogram("input_ms");
+Histogram hud_histogram("hud_ms");
+// Input-to-photon latency per kind of key, from the key event to the
+// return of the buffer swap of the first frame showing its effect.
+// Recorded only when TETRIS_INPUT_LATENCY is swap or finish; finish also
+// waits in glFinish after the swap, for when the swap returns early.
+enum INPUT_KIND {
+    INPUT_LEFT,
+    INPUT_RIGHT,
+    INPUT_DOWN,
+    INPUT_ROTATE,
+    INPUT_DROP,
+    TOTAL_INPUT_KINDS
+};
+enum LATENCY_MODE {
+    LATENCY_OFF,
+    LATENCY_SWAP,
+    LATENCY_FINISH
+};
+LATENCY_MODE latency_mode = LATENCY_OFF;
+Histogram photon_left_histogram("photon_left_ms");
+Histogram photon_right_histogram("photon_right_ms");
+Histogram photon_down_histogram("photon_down_ms");
+Histogram photon_rotate_histogram("photon_rotate_ms");
+Histogram photon_drop_histogram("photon_drop_ms");
+Histogram* const photon_histograms[TOTAL_INPUT_KINDS] = {
+    &photon_left_histogram, &photon_right_histogram, &photon_down_histogram,
+    &photon_rotate_histogram, &photon_drop_histogram
+};
+Histogram* const histograms[] = {
+    &frame_histogram, &swap_histogram, &tick_histogram, &input_histogram, &hud_histogram,
+    &photon_left_histogram, &photon_right_histogram, &photon_down_histogram,
+    &photon_rotate_histogram, &photon_drop_histogram
+};
+const int TOTAL_HISTOGRAMS = sizeof(histograms) / sizeof(histograms[0]);
+
+// Startup phases of the main and the preparation thread, in ms since the
+// process started, printed once the first frame has been swapped
+struct StartupPhase {
+    const char* name;
+    const char* thread;
+    double start_ms;
+    double end_ms;
+};
+const int MAX_STARTUP_PHASES = 32;
+StartupPhase startup_phases[MAX_STARTUP_PHASES];
+std::atomic<int> startup_phase_count(0);
+const std::chrono::steady_clock::time_point startup_origin = std::chrono::steady_clock::now();
+
+// Game logic runs in fixed ticks on its own thread, independent of the
+// frame rate. Everything from here to the snapshot below belongs to it.
+const int SIM_HZ = 120;
+const double SIM_TICK = 1.0 / SIM_HZ;
+// Ticks run at most per frame; a longer stall slows the game down instead
+// of making every following frame even longer
+const int MAX_CATCH_UP_TICKS = 8;
+double drop_speed = 1.6;
+// Progress towards the next gravity step, in steps
+double gravity = 0.;
+long long int sim_ticks = 0;
+long long int sim_ticks_dropped = 0;
+// Key presses and releases, stamped with glfwGetTime() by the main thread
+// and applied by the first tick that ends after them
+struct KeyEvent {
+    int key;
+    int action;
+    double time;
+};
+SpscRing<KeyEvent, 128> key_events;
+// A key event that changed the game, handed back to the render thread
+// with the game_version that first contains its effect
+struct AppliedInput {
+    INPUT_KIND kind;
+    double time;
+    unsigned long long int version;
+};
+SpscRing<AppliedInput, 128> applied_inputs;
+// Simulation thread only, the render thread reads it from the snapshot
+long long int applied_inputs_dropped = 0;
+// Auto-repeat for held keys, counted in ticks. A held left or right moves
+// once, waits das_ticks, then moves every arr_ticks (0 slides to the wall).
+// A held down moves every soft_drop_ticks (0 drops to the surface).
+int das_ticks = 16;
+int arr_ticks = 4;
+int soft_drop_ticks = 4;
+bool held_left = false;
+bool held_right = false;
+bool held_down = false;
+// -1 or 1 while left or right is held, the most recent press wins
+int shift_dir = 0;
+int shift_held_ticks = 0;
+int down_held_ticks = 0;
+// TETRIS_AUTOPLAY=1 hands the game to the bot, which replaces the arrow
+// keys and space with one input every autoplay_ticks (TETRIS_AUTOPLAY_MS).
+// TETRIS_AUTOPLAY_BEAM=W plans with the next piece as well, keeping the W
+// best boards, and TETRIS_AUTOPLAY_MCTS=N runs N tree search playouts per
+// piece instead; both run on the job system.
+//
+// The search runs once per piece on the planner thread, so however long
+// it takes no tick waits for it; the piece keeps falling meanwhile. It
+// picks where the piece should lock. The simulation then finds the path
+// there from wherever the piece is, which takes microseconds, again each
+// time gravity moves the piece, and asks for a new search only when the
+// target can no longer be reached.
+bool autoplay = false;
+int autoplay_ticks = 6;
+Bot* bot = NULL;
+BeamSearch* beam = NULL;
+// Board scores shared by the beam search from one piece to the next, of
+// TETRIS_AUTOPLAY_TABLE_MB megabytes; off by default, as scoring a board
+// costs about what a lookup does. The Monte Carlo search has no table.
+TranspositionTable* beam_table = NULL;
+MonteCarloSearch* mcts = NULL;
+int mcts_playouts = 0;
+
+// What the planner thread searches, and what it found, under planner_mutex
+struct PlanRequest {
+    Bitboard board;
+    SHAPE_TYPE pieces[2];
+    int known;
+    PiecePosition start;
+    long long int serial;
+};
+struct PlanResult {
+    bool found;
+    PiecePosition target;
+    long long int serial;
+};
+std::thread planner_thread;
+std::mutex planner_mutex;
+std::condition_variable planner_wake;
+PlanRequest plan_request;
+bool plan_requested = false;
+bool planner_busy = false;
+bool planner_quit = false;
+PlanResult plan_result;
+bool plan_ready = false;
+// Beam search boards and table use since the last telemetry line
+long long int plan_nodes = 0;
+long long int plan_table_probes = 0;
+long long int plan_table_hits = 0;
+
+// Simulation thread only: the piece the last search was asked for, the
+// target it gave and the path there from where the piece was
+long long int bot_requested_serial = -1;
+PlanResult bot_target = {false, {0, 0, 0}, -1};
+PlacementFinder* bot_router = NULL;
+PLACEMENT_INPUT bot_plan[PlacementFinder::MAX_INPUTS];
+int bot_plan_length = 0;
+int bot_plan_next = 0;
+// board_hash ^ the piece's hash when bot_plan was last followed
+uint64_t bot_expected_hash = 0;
+int bot_wait_ticks = 0;
+// Cells of the active piece at the start of the current tick, rendering
+// interpolates from there; the serial tells whether it is the same piece
+coordinate piece_prev[SQUARE_PER_SHAPE];
+long long int piece_serial = 0;
+long long int piece_prev_serial = -1;
+
+// Bumped whenever the game state changes, so present-on-change mode
+// can tell an identical frame without comparing the board
+unsigned long long int game_version = 1;
+
+// What the render thread needs of one tick, copied out as a whole so it
+// never reads state the simulation is in the middle of changing
+struct GameSnapshot {
+    bool board[TOTAL_ROWS][TOTAL_COLS];
+    bool has_piece;
+    coordinate piece[SQUARE_PER_SHAPE];
+    // Rigid move of the piece during the tick, rendering slides over it
+    bool sliding;
+    int slide_dr;
+    int slide_dc;
+    // glfwGetTime() at the end of the tick
+    double tick_time;
+    unsigned long long int version;
+    long long int score;
+    long long int lines;
+    int level;
+    double drop_speed;
+    SHAPE_TYPE next_type;
+    long long int sim_ticks;
+    long long int sim_ticks_dropped;
+    long long int applied_inputs_dropped;
+    bool ending;
+
+    GameSnapshot(): has_piece(false), sliding(false), slide_dr(0), slide_dc(0),
+                    tick_time(0.), version(0), score(0), lines(0), level(0),
+                    drop_speed(0.), next_type(TETRIS_TOTALSHAPE), sim_ticks(0),
+                    sim_ticks_dropped(0), applied_inputs_dropped(0), ending(false) {}
+};
+TripleBuffer<GameSnapshot> snapshots;
+
+// Particle effects are spawned by the render thread; the simulation only
+// queues where they go. A row burst has col < 0.
+struct ParticleBurst {
+    int row;
+    int col;
+    int count;
+    float hue;
+};
+SpscRing<ParticleBurst, 256> particle_bursts;
+
+std::atomic<bool> sim_running(false);
+
+// Bumped by the main thread when the window is resized
+unsigned long long int view_version = 0;
+
+// P pauses; losing focus or iconifying the window pauses as well unless
+// TETRIS_AUTO_PAUSE=0. While paused the simulation thread waits on
+// pause_changed and the main loop blocks in glfwWaitEvents.
+bool paused_by_player = false;
+bool auto_pause = true;
+bool window_focused = true;
+bool window_iconified = false;
+std::atomic<bool> sim_paused(false);
+std::mutex pause_mutex;
+std::condition_variable pause_changed;
+
+bool present_on_change = false;
+long long int frames_presented = 0;
+long long int frames_skipped = 0;
+
+// Frame pacing: sleep in the event wait until shortly before the next
+// frame is due, then poll for the rest so wake-up jitter does not make
+// the frame late. TETRIS_MAX_FPS=0 removes the cap, TETRIS_VSYNC=1 lets
+// the swap wait for the display instead
+double max_fps = 60.0;
+bool vsync = false;
+const double PACER_SPIN = 0.002;
+// Time asleep and how late frames started, since the last telemetry line
+double pace_sleep = 0.;
+double pace_late = 0.;
+double pace_late_max = 0.;
+long long int pace_frames = 0;
+
+// Text copy of the board, sent to the terminal named by TETRIS_TERMINAL
+TerminalRenderer* terminal = NULL;
+FILE* terminal_file = NULL;
+// Set when the terminal was resized, which may have scrolled or cleared it
+volatile std::sig_atomic_t terminal_resized = 0;
+
+void on_terminal_resize(int) {
+    terminal_resized = 1;
+}
+
+#ifdef TETRIS_HEADLESS
+// Number of frames a headless run lasts before the window is closed
+long long int headless_frames = 600;
+
+// Feeds a reproducible stream of key presses to the game, one every
+// few frames, and asks the window to close once the frame budget is spent
+void headless_drive(GLFWwindow* window, long long int frame) {
+    static const int keys[] = {
+        GLFW_KEY_LEFT, GLFW_KEY_RIGHT, GLFW_KEY_DOWN, GLFW_KEY_UP, GLFW_KEY_SPACE
+    };
+    static unsigned int seed = 12345;
+
+    if (frame >= headless_frames) {
+        glfwNullInjectClose(window);
+        return;
+    }
+    if (frame % 6 == 0 && !autoplay) {
+        seed = seed * 1103515245 + 12345;
+        int key = keys[(seed >> 16) % 5];
+        glfwNullInjectKey(window, key, 0, GLFW_PRESS, 0);
+        glfwNullInjectKey(window, key, 0, GLFW_RELEASE, 0);
+    }
+}
+#endif
+
 void mouse_button_callback4(GLFWwindow* window, int button, int action, int mods);
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-    glViewport(0, 0, width, height);
+    ++view_version;
+    RenderTarget::resize(width, height);
 }
 
-void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+// Moves the active piece sideways, `cells` at most, stopping at the board
+void shift_piece(int dir, int cells) {
+    if (pTshape == NULL) {
+        return;
+    }
+    cells = std::min(cells, pTshape->distance(0, dir));
+    if (cells > 0) {
+        pTshape->shift(0, dir * cells);
+        ++game_version;
+    }
+}
+
+void drop_piece(int cells) {
+    if (pTshape == NULL) {
+        return;
+    }
+    cells = std::min(cells, pTshape->distance(1, 0));
+    if (cells > 0) {
+        pTshape->shift(cells, 0);
+        ++game_version;
+    }
+}
+
+void rotate_piece() {
+    if (pTshape != NULL && pTshape->can_morph()) {
+        pTshape->morph();
+        ++game_version;
+    }
+}
+
+void apply_key_event(const KeyEvent& event)
+{
+    bool press = event.action == GLFW_PRESS;
+    switch (event.key)
+    {
+        case GLFW_KEY_LEFT:
+        case GLFW_KEY_RIGHT: {
+            int dir = event.key == GLFW_KEY_LEFT ? -1 : 1;
+            (dir < 0 ? held_left : held_right) = press;
+            if (press) {
+                shift_dir = dir;
+                shift_held_ticks = 0;
+                shift_piece(dir, 1);
+            } else if (shift_dir == dir) {
+                // Fall back to the other direction if it is still held,
+                // it starts its own delay
+                shift_dir = held_left ? -1 : (held_right ? 1 : 0);
+                shift_held_ticks = 0;
+            }
+            break;
+        }
+        case GLFW_KEY_DOWN:
+            held_down = press;
+            if (press) {
+                down_held_ticks = 0;
+                drop_piece(soft_drop_ticks == 0 ? TOTAL_ROWS : 1);
+            }
+            break;
+        case GLFW_KEY_UP:
+            if (press) {
+                rotate_piece();
+            }
+            break;
+        case GLFW_KEY_SPACE:
+            if (press) {
+                drop_piece(TOTAL_ROWS);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void track_input_latency(const KeyEvent& event)
+{
+    AppliedInput input = {INPUT_LEFT, event.time, game_version};
+    switch (event.key)
+    {
+        case GLFW_KEY_LEFT: input.kind = INPUT_LEFT; break;
+        case GLFW_KEY_RIGHT: input.kind = INPUT_RIGHT; break;
+        case GLFW_KEY_DOWN: input.kind = INPUT_DOWN; break;
+        case GLFW_KEY_UP: input.kind = INPUT_ROTATE; break;
+        case GLFW_KEY_SPACE: input.kind = INPUT_DROP; break;
+        default: return;
+    }
+    if (!applied_inputs.push(input)) {
+        ++applied_inputs_dropped;
+    }
+}
+
+// Applies the key events up to tick_time, then the auto-repeat of held keys
+void process_input(double tick_time)
 {
-    if (action == GLFW_PRESS) {
-    // Update the position of the first vertex if the keys 1,2, or 3 are pressed
-        switch (key)
+    TRACE_ZONE("process_input");
+    KeyEvent event;
+    while (key_events.peek(&event) && event.time <= tick_time) {
+        key_events.pop(&event);
+        unsigned long long int version_before = game_version;
+        apply_key_event(event);
+        input_histogram.record(1000.0 * (glfwGetTime() - event.time));
+        if (latency_mode != LATENCY_OFF && event.action == GLFW_PRESS &&
+            game_version != version_before) {
+            track_input_latency(event);
+        }
+    }
+
+    if (shift_dir != 0 && ++shift_held_ticks >= das_ticks) {
+        if (arr_ticks == 0) {
+            shift_piece(shift_dir, TOTAL_COLS);
+        } else if ((shift_held_ticks - das_ticks) % arr_ticks == 0) {
+            shift_piece(shift_dir, 1);
+        }
+    }
+    if (held_down && ++down_held_ticks >= std::max(soft_drop_ticks, 1)) {
+        down_held_ticks = 0;
+        drop_piece(soft_drop_ticks == 0 ? TOTAL_ROWS : 1);
+    }
+}
+
+// Runs one search per request until planner_quit
+void planner_main() {
+    TRACE_THREAD("planner");
+    for (;;) {
+        PlanRequest request;
         {
-            case GLFW_KEY_LEFT:
-                if (pTshape != NULL && pTshape->can_move_left()) {
-                    pTshape->move_left();
-                }
-                break;
-            case GLFW_KEY_RIGHT:
-                if (pTshape != NULL && pTshape->can_move_right()) {
-                    pTshape->move_right();
-                }
-                break;
-            case GLFW_KEY_DOWN:
-                if (pTshape != NULL && pTshape->can_move_down()) {
-                    pTshape->move_down();
-                }
-                break;
-            case GLFW_KEY_UP:
-                if (pTshape != NULL && pTshape->can_morph()) {
-                    pTshape->morph();
-                }
-                break;
-            case GLFW_KEY_SPACE:
-                if (pTshape != NULL) {
-                    pTshape->move_to_bottom();
-                }
-                break;
-            default:
-                break;
+            std::unique_lock<std::mutex> lock(planner_mutex);
+            planner_wake.wait(lock, [] { return plan_requested || planner_quit; });
+            if (planner_quit) {
+                return;
+            }
+            request = plan_request;
+            plan_requested = false;
+            planner_busy = true;
+        }
+
+        TRACE_ZONE("plan_autoplay");
+        const PlacementFinder* finder = &bot->finder();
+        int best;
+        if (mcts != NULL) {
+            best = mcts->choose(request.board, request.pieces, request.known, request.start,
+                                mcts_playouts);
+            finder = &mcts->finder();
+        } else if (beam != NULL) {
+            best = beam->choose(request.board, request.pieces, request.known, request.start);
+            finder = &beam->finder();
+        } else {
+            best = bot->choose(request.board, request.pieces[0], request.start);
+        }
+
+        std::lock_guard<std::mutex> lock(planner_mutex);
+        if (mcts == NULL && beam != NULL) {
+            plan_nodes += beam->nodes();
+            plan_table_probes += beam->table_probes();
+            plan_table_hits += beam->table_hits();
+        }
+        plan_result.found = best >= 0;
+        if (plan_result.found) {
+            plan_result.target = finder->placement(best).position;
+        }
+        plan_result.serial = request.serial;
+        plan_ready = true;
+        planner_busy = false;
+    }
+}
+
+void start_planner() {
+    bot_router = new PlacementFinder();
+    planner_thread = std::thread(planner_main);
+}
+
+void stop_planner() {
+    if (!planner_thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(planner_mutex);
+        planner_quit = true;
+    }
+    planner_wake.notify_one();
+    planner_thread.join();
+    delete bot_router;
+    bot_router = NULL;
+}
+
+// Takes a finished search and, when the planner is free and the piece has
+// none yet, asks for one from where the piece is now
+void exchange_plan() {
+    std::lock_guard<std::mutex> lock(planner_mutex);
+    if (plan_ready) {
+        plan_ready = false;
+        bot_target = plan_result;
+        // Routed on the next step
+        bot_expected_hash = ~(board_hash ^ pTshape->hash);
+    }
+    if (bot_requested_serial == piece_serial || planner_busy || plan_requested) {
+        return;
+    }
+    PiecePosition now;
+    if (!PlacementFinder::locate(pTshape->stype, pTshape->cdnt, &now)) {
+        return;
+    }
+    plan_request.board = Bitboard::from_grid(board_grid);
+    plan_request.pieces[0] = pTshape->stype;
+    plan_request.pieces[1] = next_type;
+    plan_request.known = next_type == TETRIS_TOTALSHAPE ? 1 : 2;
+    plan_request.start = now;
+    plan_request.serial = piece_serial;
+    plan_requested = true;
+    bot_requested_serial = piece_serial;
+    planner_wake.notify_one();
+}
+
+// The path from where the piece is to the target; false when it can not
+// get there any more
+bool route_autoplay() {
+    TRACE_ZONE("route_autoplay");
+    bot_plan_length = 0;
+    bot_plan_next = 0;
+    bot_expected_hash = board_hash ^ pTshape->hash;
+    PiecePosition now;
+    if (!PlacementFinder::locate(pTshape->stype, pTshape->cdnt, &now)) {
+        return false;
+    }
+    int count = bot_router->find(Bitboard::from_grid(board_grid), pTshape->stype, now);
+    for (int i = 0; i < count; ++i) {
+        const PiecePosition& position = bot_router->placement(i).position;
+        if (position.orientation == bot_target.target.orientation &&
+            position.row == bot_target.target.row && position.col == bot_target.target.col) {
+            int length = bot_router->path(i, bot_plan, PlacementFinder::MAX_INPUTS);
+            bot_plan_length = std::max(length, 0);
+            return length >= 0;
         }
     }
+    return false;
+}
+
+// Applies the bot's next input when one is due, routing first if the
+// piece is not where the last input left it
+void autoplay_tick() {
+    if (pTshape == NULL) {
+        return;
+    }
+    exchange_plan();
+    if (bot_target.serial != piece_serial || !bot_target.found) {
+        return;
+    }
+    // The hashes tell whether anything moved without locating the piece
+    if ((board_hash ^ pTshape->hash) != bot_expected_hash && !route_autoplay()) {
+        // Gravity took the piece past the way in, search again from here
+        bot_target.serial = -1;
+        bot_requested_serial = -1;
+        return;
+    }
+    if (bot_plan_next >= bot_plan_length || ++bot_wait_ticks < autoplay_ticks) {
+        return;
+    }
+    bot_wait_ticks = 0;
+    switch (bot_plan[bot_plan_next++]) {
+        case PLACE_LEFT: shift_piece(-1, 1); break;
+        case PLACE_RIGHT: shift_piece(1, 1); break;
+        case PLACE_DOWN: drop_piece(1); break;
+        case PLACE_ROTATE: rotate_piece(); break;
+        case PLACE_DROP: drop_piece(TOTAL_ROWS); break;
+    }
+    bot_expected_hash = board_hash ^ pTshape->hash;
+}
+
+// TETRIS_DAS_MS and friends, rounded to whole ticks
+int env_ms_to_ticks(const char* name, int fallback)
+{
+    const char* value = getenv(name);
+    if (value == NULL) {
+        return fallback;
+    }
+    return std::max((int)(atof(value) * SIM_HZ / 1000.0 + 0.5), 0);
+}
+
+void update_pause()
+{
+    bool paused = paused_by_player || (auto_pause && (!window_focused || window_iconified));
+    if (paused != sim_paused.load(std::memory_order_relaxed)) {
+        {
+            std::lock_guard<std::mutex> lock(pause_mutex);
+            sim_paused.store(paused, std::memory_order_release);
+        }
+        pause_changed.notify_all();
+        ++view_version;
+        LOG_INFO("%s", paused ? "paused" : "resumed");
+    }
+}
+
+void window_focus_callback(GLFWwindow* window, int focused)
+{
+    window_focused = focused == GL_TRUE;
+    update_pause();
+}
+
+void window_iconify_callback(GLFWwindow* window, int iconified)
+{
+    window_iconified = iconified == GL_TRUE;
+    update_pause();
+}
+
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    if (key == GLFW_KEY_Q) {
+        if (action == GLFW_PRESS) {
+            RenderTarget::cycle();
+        }
+        return;
+    }
+    if (key == GLFW_KEY_P) {
+        if (action == GLFW_PRESS) {
+            paused_by_player = !paused_by_player;
+            update_pause();
+        }
+        return;
+    }
+    // The bot plays instead of the keyboard
+    if (autoplay) {
+        return;
+    }
+    // Presses while paused are dropped, releases still end held keys
+    if (action == GLFW_PRESS && sim_paused.load(std::memory_order_relaxed)) {
+        return;
+    }
+    // Repeats come from the simulation's own timing, not the OS
+    if (action != GLFW_REPEAT) {
+        KeyEvent event = {key, action, glfwGetTime()};
+        key_events.push(event);
+    }
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 {
 }
 
+uint32_t grid_row_bits(const bool cells[TOTAL_COLS]) {
+    uint32_t bits = 0;
+    for (int col = 0; col < TOTAL_COLS; ++col) {
+        bits |= (uint32_t)cells[col] << col;
+    }
+    return bits;
+}
+
 void check_grid() {
+    TRACE_ZONE("check_grid");
     for (int row = 0; row < TOTAL_ROWS; ++row) {
         for (int col = 0; col < TOTAL_COLS; ++col) {
             board_grid_backup[row][col] = board_grid[row][col];
@@ -101,9 +728,24 @@ void check_grid() {
         }
 
         if (sq_set_num == TOTAL_COLS) {
-            std::cout << "Shift down one row";
+            LOG_DEBUG("Shift down row %d", row);
             ++total_smashed;
             ind_vec.push_back(row);
+            ParticleBurst burst = {row, -1, 0, 0.f};
+            particle_bursts.push(burst);
+        }
+    }
+
+    size_t cleared = std::min(ind_vec.size(), (size_t)SQUARE_PER_SHAPE);
+    total_lines += ind_vec.size();
+    score += LINE_SCORES[cleared] * (level + 1);
+
+    // Top to bottom, so clearing a row never moves the ones left to clear
+    for (size_t i = 0; i < ind_vec.size(); ++i) {
+        uint32_t above = (1u << ind_vec[i]) - 1;
+        for (int col = 0; col < TOTAL_COLS; ++col) {
+            uint32_t bits = board_col_bits[col];
+            board_col_bits[col] = (bits & ~(above | (above + 1))) | ((bits & above) << 1);
         }
     }
 
@@ -112,12 +754,18 @@ void check_grid() {
         size_t cursize = ind_vec.size();
         if (cursize > 0 && ind_vec[cursize - 1] == row) {
             ind_vec.pop_back();
+            board_hash ^= Zobrist::row(row, (1u << TOTAL_COLS) - 1);
             continue;
         }
 
+        if (real_row != row) {
+            uint32_t bits = grid_row_bits(board_grid_backup[row]);
+            board_hash ^= Zobrist::row(row, bits) ^ Zobrist::row(real_row, bits);
+        }
         for (int col = 0; col < TOTAL_COLS; ++col) {
             board_grid[real_row][col] = board_grid_backup[row][col];
         }
+        board_row_bits[real_row] = board_row_bits[row];
         real_row--;
     }
 
@@ -125,10 +773,12 @@ void check_grid() {
         for (int col = 0; col < TOTAL_COLS; ++col) {
             board_grid[row][col] = false;
         }
+        board_row_bits[row] = 0;
     }
 }
 
 void check_game_ending() {
+    TRACE_ZONE("check_game_ending");
     if (pTshape != NULL) {
         for (int i = 0; i < SQUARE_PER_SHAPE; ++i) {
             if (board_grid[pTshape->cdnt[i].x][pTshape->cdnt[i].y]) {
@@ -139,29 +789,311 @@ void check_game_ending() {
 }
 
 void run_game() {
+    TRACE_ZONE("run_game");
+    // Every tick moves, locks or spawns a piece
+    ++game_version;
     if (pTshape != NULL && pTshape->can_move_down()) {
         pTshape->move_down();
     } else if (pTshape != NULL) {
+        float hue = (float)pTshape->stype / TETRIS_TOTALSHAPE;
+        for (int i = 0; i < SQUARE_PER_SHAPE; ++i) {
+            ParticleBurst burst = {pTshape->cdnt[i].x, pTshape->cdnt[i].y,
+                                   Particles::PER_LOCKED_CELL, hue};
+            particle_bursts.push(burst);
+        }
         pTshape->persist();
         delete pTshape;
         pTshape = NULL;
     } else {
-        std::cout << "need new Tetris shape\n";
-        SHAPE_TYPE rnd_type = static_cast<SHAPE_TYPE>(rand() % TETRIS_TOTALSHAPE);
-        pTshape = new TetrisShape(rnd_type);
+        LOG_DEBUG("need new Tetris shape");
+        if (next_type == TETRIS_TOTALSHAPE) {
+            next_type = static_cast<SHAPE_TYPE>(rand() % TETRIS_TOTALSHAPE);
+        }
+        pTshape = new TetrisShape(next_type);
+        ++piece_serial;
+        next_type = static_cast<SHAPE_TYPE>(rand() % TETRIS_TOTALSHAPE);
         // pTshape = new TetrisShape(TETRIS_RIGHTNSHAPE);
     }
     check_game_ending();
     check_grid();
 }
 
-void render_game(OglRect *pRects[TOTAL_SQUARE_NUM]) {
+void sim_tick(double tick_time) {
+    TRACE_ZONE("sim_tick");
+    ++sim_ticks;
+    if (pTshape != NULL) {
+        for (int i = 0; i < SQUARE_PER_SHAPE; ++i) {
+            piece_prev[i] = pTshape->cdnt[i];
+        }
+        piece_prev_serial = piece_serial;
+    } else {
+        piece_prev_serial = -1;
+    }
+
+    process_input(tick_time);
+    if (autoplay) {
+        autoplay_tick();
+    }
+
+    gravity += drop_speed * SIM_TICK;
+    if (gravity >= 1.0) {
+        gravity -= 1.0;
+        run_game();
+        if (total_smashed % 12 == 0 && drop_speed < 10.0) {
+            LOG_INFO("level %d, total smashed: %lld", level + 1, total_smashed);
+            total_smashed = 1;
+            drop_speed += 0.1;
+            ++level;
+        }
+    }
+}
+
+// Offset in cells from where the active piece is to where it was at the
+// start of the tick. Only plain moves slide, rotations and new pieces snap.
+bool piece_slide(int* dr, int* dc) {
+    if (pTshape == NULL || piece_prev_serial != piece_serial) {
+        return false;
+    }
+    *dr = piece_prev[0].x - pTshape->cdnt[0].x;
+    *dc = piece_prev[0].y - pTshape->cdnt[0].y;
+    for (int i = 1; i < SQUARE_PER_SHAPE; ++i) {
+        if (piece_prev[i].x - pTshape->cdnt[i].x != *dr ||
+            piece_prev[i].y - pTshape->cdnt[i].y != *dc) {
+            return false;
+        }
+    }
+    return *dr != 0 || *dc != 0;
+}
+
+void publish_snapshot(double tick_time) {
+    TRACE_ZONE("publish_snapshot");
+    GameSnapshot& snap = snapshots.write_buffer();
     for (int r = 0; r < TOTAL_ROWS; ++r) {
         for (int c = 0; c < TOTAL_COLS; ++c) {
-            if (board_grid[r][c] || 
-                (pTshape != NULL && pTshape->is_display(r, c))) {
-                pRects[r * TOTAL_ROWS + c]->render();
+            snap.board[r][c] = board_grid[r][c];
+        }
+    }
+    snap.has_piece = pTshape != NULL;
+    if (pTshape != NULL) {
+        for (int i = 0; i < SQUARE_PER_SHAPE; ++i) {
+            snap.piece[i] = pTshape->cdnt[i];
+        }
+    }
+    snap.sliding = piece_slide(&snap.slide_dr, &snap.slide_dc);
+    snap.tick_time = tick_time;
+    snap.version = game_version;
+    snap.score = score;
+    snap.lines = total_lines;
+    snap.level = level;
+    snap.drop_speed = drop_speed;
+    snap.next_type = next_type;
+    snap.sim_ticks = sim_ticks;
+    snap.sim_ticks_dropped = sim_ticks_dropped;
+    snap.applied_inputs_dropped = applied_inputs_dropped;
+    snap.ending = is_ending;
+    snapshots.publish();
+}
+
+// Runs every tick that is due, sleeps until the next one and publishes a
+// snapshot after each batch. Nothing here waits on the render thread.
+void sim_thread_main() {
+    TRACE_THREAD("simulation");
+    double next_tick = glfwGetTime() + SIM_TICK;
+    publish_snapshot(glfwGetTime());
+    while (sim_running.load(std::memory_order_acquire) && !is_ending) {
+        if (sim_paused.load(std::memory_order_acquire)) {
+            TRACE_ZONE("paused");
+            std::unique_lock<std::mutex> lock(pause_mutex);
+            pause_changed.wait(lock, [] {
+                return !sim_paused.load(std::memory_order_acquire) ||
+                       !sim_running.load(std::memory_order_acquire);
+            });
+            // The paused time is not caught up on
+            next_tick = glfwGetTime() + SIM_TICK;
+            continue;
+        }
+        double now = glfwGetTime();
+        if (now < next_tick) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(next_tick - now));
+            continue;
+        }
+        int ticks = 0;
+        while (now >= next_tick && !is_ending) {
+            if (ticks == MAX_CATCH_UP_TICKS) {
+                long long int behind = (long long int)((now - next_tick) / SIM_TICK) + 1;
+                sim_ticks_dropped += behind;
+                next_tick += behind * SIM_TICK;
+                break;
             }
+            double tick_start = glfwGetTime();
+            sim_tick(next_tick);
+            tick_histogram.record(1000.0 * (glfwGetTime() - tick_start));
+            next_tick += SIM_TICK;
+            ++ticks;
+        }
+        publish_snapshot(glfwGetTime());
+    }
+}
+
+// Once a second summary of the CPU frame times and the GPU time of each pass
+void print_telemetry(const HudStats& stats, const GameSnapshot& snap) {
+    printf("frame %.2f ms avg %.2f ms max, quality %s%s", stats.frame_avg_ms,
+           stats.frame_max_ms, stats.quality, stats.quality_auto ? " auto" : "");
+    if (GpuTimers::supported) {
+        printf(" | gpu");
+        for (int p = 0; p < GpuTimers::TOTAL_PASSES; ++p) {
+            GpuTimers::PASS pass = static_cast<GpuTimers::PASS>(p);
+            printf(" %s %.3f/%.3f", GpuTimers::names[p],
+                   GpuTimers::average_ms(pass), GpuTimers::max_ms(pass));
+        }
+        printf(" ms avg/max, %lld late", GpuTimers::late);
+    }
+    double paced = (double)std::max(pace_frames, 1LL);
+    printf(" | pacing %s %.0f fps, %.1f ms asleep/frame, %.3f/%.3f ms late avg/max",
+           vsync ? "vsync" : "cap", max_fps, 1000.0 * pace_sleep / paced,
+           1000.0 * pace_late / paced, 1000.0 * pace_late_max);
+    pace_sleep = pace_late = pace_late_max = 0.;
+    pace_frames = 0;
+    printf(" | p50/p99/max");
+    for (int h = 0; h < TOTAL_HISTOGRAMS; ++h) {
+        if (histograms[h]->count() == 0) {
+            continue;
+        }
+        printf(" %s %.2f/%.2f/%.2f", histograms[h]->name(), histograms[h]->percentile_ms(0.5),
+               histograms[h]->percentile_ms(0.99), histograms[h]->max_ms());
+    }
+    if (snap.applied_inputs_dropped > 0) {
+        printf(" | %lld inputs not timed, queue full", snap.applied_inputs_dropped);
+    }
+    printf(" | sim %lld ticks, %lld dropped", snap.sim_ticks, snap.sim_ticks_dropped);
+    if (present_on_change) {
+        long long int frames = frames_presented + frames_skipped;
+        printf(" | skipped %lld of %lld frames (%.1f%%)", frames_skipped, frames,
+               frames > 0 ? 100.0 * frames_skipped / frames : 0.);
+    }
+    if (terminal != NULL && terminal->frames > 0) {
+        printf(" | terminal %lld frames, %.1f bytes/frame", terminal->frames,
+               (double)terminal->bytes_total / terminal->frames);
+    }
+    if (beam_table != NULL) {
+        std::lock_guard<std::mutex> lock(planner_mutex);
+        printf(" | table %lld/%lld probes hit (%.1f%%), %.1f%% of boards, %.1f MB",
+               plan_table_hits, plan_table_probes,
+               100.0 * plan_table_hits / std::max(plan_table_probes, 1LL),
+               100.0 * plan_table_hits / std::max(plan_nodes, 1LL),
+               beam_table->memory_bytes() / 1048576.0);
+        plan_nodes = plan_table_probes = plan_table_hits = 0;
+    }
+    // Times the CPU blocked on a fenced region out of all regions mapped
+    printf(" | buffer waits hud %lld/%lld particles %lld/%lld, %.2f ms",
+           Hud::VBO.region_waits, Hud::VBO.region_maps,
+           Particles::VBO_I.region_waits, Particles::VBO_I.region_maps,
+           Hud::VBO.region_wait_ms + Particles::VBO_I.region_wait_ms);
+    printf("\n");
+}
+
+// Writes <base>.json with the summary and buckets of every histogram and
+// <base>.csv with one row per bucket
+void write_histograms(const std::string& base) {
+    FILE* json = fopen((base + ".json").c_str(), "w");
+    if (json == NULL) {
+        fprintf(stderr, "Can not write %s.json\n", base.c_str());
+    } else {
+        fprintf(json, "{\n");
+        for (int h = 0; h < TOTAL_HISTOGRAMS; ++h) {
+            fprintf(json, "  \"%s\": ", histograms[h]->name());
+            histograms[h]->write_json(json);
+            fprintf(json, "%s\n", h + 1 < TOTAL_HISTOGRAMS ? "," : "");
+        }
+        fprintf(json, "}\n");
+        fclose(json);
+    }
+
+    FILE* csv = fopen((base + ".csv").c_str(), "w");
+    if (csv == NULL) {
+        fprintf(stderr, "Can not write %s.csv\n", base.c_str());
+    } else {
+        fprintf(csv, "histogram,lower_ms,upper_ms,count\n");
+        for (int h = 0; h < TOTAL_HISTOGRAMS; ++h) {
+            histograms[h]->write_csv(csv);
+        }
+        fclose(csv);
+    }
+}
+
+// Every input whose effect is in the frame just swapped has reached the
+// screen, as far as the application can tell
+void record_input_latency(unsigned long long int shown_version) {
+    if (latency_mode == LATENCY_FINISH) {
+        glFinish();
+    }
+    double shown = glfwGetTime();
+    AppliedInput input;
+    while (applied_inputs.peek(&input) && input.version <= shown_version) {
+        applied_inputs.pop(&input);
+        photon_histograms[input.kind]->record(1000.0 * (shown - input.time));
+    }
+}
+
+void render_terminal(TerminalRenderer& term, const GameSnapshot& snap) {
+    for (int r = 0; r < TOTAL_ROWS; ++r) {
+        for (int c = 0; c < TOTAL_COLS; ++c) {
+            term.set_cell(r, c, snap.board[r][c] ? TerminalRenderer::CELL_BOARD
+                                                 : TerminalRenderer::CELL_EMPTY);
+        }
+    }
+    if (snap.has_piece) {
+        for (int i = 0; i < SQUARE_PER_SHAPE; ++i) {
+            term.set_cell(snap.piece[i].x, snap.piece[i].y, TerminalRenderer::CELL_PIECE);
+        }
+    }
+    term.present();
+}
+
+// Spawns the particles for everything the simulation queued
+void drain_particle_bursts() {
+    // Rows cleared by the same tick are queued back to back and emitted
+    // together, so they split the clear budget between them
+    int rows[TOTAL_ROWS];
+    int row_num = 0;
+    ParticleBurst burst;
+    while (particle_bursts.pop(&burst)) {
+        if (burst.col >= 0) {
+            Particles::emit_cell(burst.row, burst.col, burst.count, burst.hue);
+        } else if (row_num < TOTAL_ROWS) {
+            rows[row_num++] = burst.row;
+        }
+    }
+    Particles::emit_rows(rows, row_num, TOTAL_COLS);
+}
+
+// alpha is how far the simulation is into the next tick, from 0 to 1
+void render_game(OglRect *pRects[TOTAL_SQUARE_NUM], const GameSnapshot& snap, float alpha) {
+    TRACE_ZONE("render_game");
+    {
+        TRACE_ZONE("OglRect::render board");
+        for (int r = 0; r < TOTAL_ROWS; ++r) {
+            for (int c = 0; c < TOTAL_COLS; ++c) {
+                if (snap.board[r][c]) {
+                    pRects[r * TOTAL_ROWS + c]->render();
+                }
+            }
+        }
+    }
+
+    if (snap.has_piece) {
+        TRACE_ZONE("OglRect::render piece");
+        const float cell = OglRect::GRID_WIDTH / 2.f;
+        float dx = 0.f;
+        float dy = 0.f;
+        if (snap.sliding) {
+            dx = snap.slide_dc * cell * (1.f - alpha);
+            dy = -snap.slide_dr * cell * (1.f - alpha);
+        }
+        for (int i = 0; i < SQUARE_PER_SHAPE; ++i) {
+            int r = snap.piece[i].x;
+            int c = snap.piece[i].y;
+            pRects[r * TOTAL_ROWS + c]->render_offset(dx, dy);
         }
     }
 }
@@ -171,6 +1103,14 @@ void free_game_memory(OglRect *pRects[TOTAL_SQUARE_NUM]) {
         delete pTshape;
         pTshape = NULL;
     }
+    delete bot;
+    bot = NULL;
+    delete beam;
+    beam = NULL;
+    delete beam_table;
+    beam_table = NULL;
+    delete mcts;
+    mcts = NULL;
 
     for (int col = 0; col < TOTAL_ROWS; ++col) {
         for (int row = 0; row < TOTAL_COLS; ++row) {
@@ -179,7 +1119,103 @@ void free_game_memory(OglRect *pRects[TOTAL_SQUARE_NUM]) {
     }
 }
 
-int task_4() {
+double startup_ms() {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - startup_origin).count();
+}
+
+// Records a phase that started at start_ms and ends now
+void startup_phase(const char* name, const char* thread, double start_ms) {
+    int i = startup_phase_count.fetch_add(1);
+    if (i < MAX_STARTUP_PHASES) {
+        StartupPhase phase = {name, thread, start_ms, startup_ms()};
+        startup_phases[i] = phase;
+    }
+}
+
+void print_startup_timeline() {
+    int count = std::min(startup_phase_count.load(), MAX_STARTUP_PHASES);
+    std::sort(startup_phases, startup_phases + count,
+              [](const StartupPhase& a, const StartupPhase& b) { return a.start_ms < b.start_ms; });
+    printf("startup timeline, ms since process start:\n");
+    for (int i = 0; i < count; ++i) {
+        printf("  %-8s %8.2f %8.2f  %s\n", startup_phases[i].thread, startup_phases[i].start_ms,
+               startup_phases[i].end_ms, startup_phases[i].name);
+    }
+}
+
+// Reads the TETRIS_* environment variables that need no GL context
+void load_config() {
+    const char* quality = getenv("TETRIS_QUALITY");
+    if (quality != NULL && !RenderTarget::select(quality)) {
+        fprintf(stderr, "Unknown TETRIS_QUALITY %s, using auto\n", quality);
+    }
+    const char* auto_pause_env = getenv("TETRIS_AUTO_PAUSE");
+    auto_pause = auto_pause_env == NULL || atoi(auto_pause_env) != 0;
+    const char* present = getenv("TETRIS_PRESENT_ON_CHANGE");
+    present_on_change = present != NULL && atoi(present) != 0;
+    const char* latency = getenv("TETRIS_INPUT_LATENCY");
+    if (latency != NULL) {
+        if (strcmp(latency, "swap") == 0) {
+            latency_mode = LATENCY_SWAP;
+        } else if (strcmp(latency, "finish") == 0) {
+            latency_mode = LATENCY_FINISH;
+        } else {
+            fprintf(stderr, "Unknown TETRIS_INPUT_LATENCY %s, use swap or finish\n", latency);
+        }
+    }
+    das_ticks = env_ms_to_ticks("TETRIS_DAS_MS", das_ticks);
+    arr_ticks = env_ms_to_ticks("TETRIS_ARR_MS", arr_ticks);
+    soft_drop_ticks = env_ms_to_ticks("TETRIS_SOFT_DROP_MS", soft_drop_ticks);
+    const char* autoplay_env = getenv("TETRIS_AUTOPLAY");
+    autoplay = autoplay_env != NULL && atoi(autoplay_env) != 0;
+    autoplay_ticks = env_ms_to_ticks("TETRIS_AUTOPLAY_MS", autoplay_ticks);
+    const char* beam_width = getenv("TETRIS_AUTOPLAY_BEAM");
+    const char* playouts = getenv("TETRIS_AUTOPLAY_MCTS");
+    if (autoplay) {
+        bot = new Bot();
+        if (playouts != NULL && atoi(playouts) > 0) {
+            JobSystem::init();
+            mcts_playouts = atoi(playouts);
+            mcts = new MonteCarloSearch();
+            if (getenv("TETRIS_AUTOPLAY_TABLE_MB") != NULL) {
+                fprintf(stderr, "TETRIS_AUTOPLAY_TABLE_MB is only used by the beam search\n");
+            }
+        } else if (beam_width != NULL && atoi(beam_width) > 0) {
+            JobSystem::init();
+            const char* table_mb = getenv("TETRIS_AUTOPLAY_TABLE_MB");
+            if (table_mb != NULL && atoi(table_mb) > 0) {
+                beam_table = new TranspositionTable(atoi(table_mb));
+            }
+            beam = new BeamSearch(atoi(beam_width), beam_table);
+        }
+        start_planner();
+    }
+    const char* terminal_path = getenv("TETRIS_TERMINAL");
+    if (terminal_path != NULL) {
+        terminal_file = fopen(terminal_path, "w");
+        if (terminal_file == NULL) {
+            fprintf(stderr, "Can not open TETRIS_TERMINAL %s\n", terminal_path);
+        } else {
+            terminal = new TerminalRenderer(TOTAL_ROWS, TOTAL_COLS, terminal_file);
+#ifdef SIGWINCH
+            signal(SIGWINCH, on_terminal_resize);
+#endif
+        }
+    }
+    const char* fps = getenv("TETRIS_MAX_FPS");
+    if (fps != NULL) {
+        max_fps = std::max(atof(fps), 0.);
+    }
+    const char* swap = getenv("TETRIS_VSYNC");
+    vsync = swap != NULL && atoi(swap) != 0;
+}
+
+// Everything before the first frame that needs no GL context. Runs on its
+// own thread while the main thread creates the window and loads GL.
+void prepare_game(OglRect *pRects[TOTAL_SQUARE_NUM]) {
+    TRACE_THREAD("startup");
+    double start = startup_ms();
     for (int r = 0; r < TOTAL_ROWS; ++r) {
         for (int c = 0; c < TOTAL_COLS; ++c) {
             board_grid[r][c] = false;
@@ -193,8 +1229,44 @@ int task_4() {
     for (int k = 14; k < 20; ++k) {
         board_grid[18][k] = true;
     }
+    board_hash = Zobrist::board(Bitboard::from_grid(board_grid));
+    for (int c = 0; c < TOTAL_COLS; ++c) {
+        board_col_bits[c] = 0;
+    }
+    for (int r = 0; r < TOTAL_ROWS; ++r) {
+        board_row_bits[r] = grid_row_bits(board_grid[r]);
+        for (int c = 0; c < TOTAL_COLS; ++c) {
+            board_col_bits[c] |= (uint32_t)board_grid[r][c] << r;
+        }
+    }
 
     srand(time(0));
+    startup_phase("game state", "prepare", start);
+
+    start = startup_ms();
+    load_config();
+    startup_phase("config", "prepare", start);
+
+    start = startup_ms();
+    OglRect::prepare();
+    for (int col = 0; col < TOTAL_ROWS; ++col) {
+        for (int row = 0; row < TOTAL_COLS; ++row) {
+            pRects[col * TOTAL_ROWS + row] = new OglRect(row, col);
+        }
+    }
+    startup_phase("board geometry", "prepare", start);
+
+    start = startup_ms();
+    Hud::prepare();
+    startup_phase("hud atlas", "prepare", start);
+}
+
+int task_4() {
+    TRACE_INIT();
+    TRACE_THREAD("main");
+
+    OglRect *pRects[TOTAL_SQUARE_NUM];
+    std::thread prepare_thread(prepare_game, pRects);
 
     GLFWwindow* window;
     
@@ -206,11 +1278,16 @@ int task_4() {
     double cur_shift_up = 0.;
 
     // Initialize the library
-    if (!glfwInit())
+    double start = startup_ms();
+    if (!glfwInit()) {
+        prepare_thread.join();
         return -1;
+    }
+    startup_phase("glfwInit", "main", start);
 
-    // Activate supersampling
-    glfwWindowHint(GLFW_SAMPLES, 8);
+    // Antialiasing is done by the offscreen render target, so the window
+    // itself stays single sampled and can be blitted into
+    glfwWindowHint(GLFW_SAMPLES, 0);
 
     // Ensure that we get at least a 3.2 context
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -223,15 +1300,47 @@ int task_4() {
 #endif
 
     // Create a windowed mode window and its OpenGL context
+    start = startup_ms();
     window = glfwCreateWindow(800, 800, "Hello World", NULL, NULL);
     if (!window)
     {
+        prepare_thread.join();
         glfwTerminate();
         return -1;
     }
 
     // Make the window's context current
     glfwMakeContextCurrent(window);
+    startup_phase("window and context", "main", start);
+
+#if defined(TETRIS_GL_LOADER)
+    // Resolve only the entry points the game calls
+    start = startup_ms();
+    int missing = gl_loader_init(glfwGetProcAddress);
+    startup_phase("GL loader", "main", start);
+    printf("GL loader: %d of %d entry points\n", GL_LOADER_FUNCTIONS - missing,
+           GL_LOADER_FUNCTIONS);
+    if (!glGenVertexArrays) {
+        fprintf(stderr, "Error: GL 3.2 entry points not found\n");
+        prepare_thread.join();
+        glfwTerminate();
+        return -1;
+    }
+#elif !defined(__APPLE__)
+    // Load the GL entry points; core profiles need the experimental path
+    glewExperimental = GL_TRUE;
+    start = startup_ms();
+    GLenum glew_status = glewInit();
+    startup_phase("glewInit", "main", start);
+    if (glew_status != GLEW_OK && !glGenVertexArrays) {
+        fprintf(stderr, "Error: %s\n", glewGetErrorString(glew_status));
+        prepare_thread.join();
+        glfwTerminate();
+        return -1;
+    }
+    // glewInit leaves a harmless GL_INVALID_ENUM behind on core profiles
+    glGetError();
+#endif
 
     int major, minor, rev;
     major = glfwGetWindowAttrib(window, GLFW_CONTEXT_VERSION_MAJOR);
@@ -244,30 +1353,63 @@ int task_4() {
     // Register the keyboard callback
     glfwSetKeyCallback(window, key_callback);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetWindowFocusCallback(window, window_focus_callback);
+    glfwSetWindowIconifyCallback(window, window_iconify_callback);
+
+    // GL setup below uses the geometry and config prepared meanwhile
+    start = startup_ms();
+    prepare_thread.join();
+    startup_phase("wait for prepare", "main", start);
 
+    start = startup_ms();
     OglRect::init();
+    Hud::init();
+    Particles::init();
+    GpuTimers::init();
+    int fb_width, fb_height;
+    glfwGetFramebufferSize(window, &fb_width, &fb_height);
+    RenderTarget::init(fb_width, fb_height);
+    startup_phase("shaders and buffers", "main", start);
+    glfwSwapInterval(vsync ? 1 : 0);
+    HudStats hud_stats;
+    // Timings as the HUD shows them, refreshed a few times a second so the
+    // HUD can draw its last quads again on the frames in between
+    HudStats hud_timing;
+    const double hudTimingPeriod = 0.25;
+    for (int i = 0; i < FRAME_HISTORY; ++i) {
+        frame_ms_history[i] = 0.;
+    }
 
     // Save the current time --- it will be used to dynamically change the triangle color
     auto t_start = std::chrono::high_resolution_clock::now();
     // Register the mouse callback
     glfwSetMouseButtonCallback(window, mouse_button_callback);
 
-    long long int nbFrames = 0;
+    long long int totalFrames = 0;
     long long int newFrames = 0;
 
-    double lastTime = glfwGetTime();
+    double lastTelemetry = glfwGetTime();
+    double lastHudTiming = lastTelemetry;
+    // What the frame on screen was drawn from
+    unsigned long long int drawn_version = 0;
+    unsigned long long int drawn_view = 0;
+    int drawn_profile = -1;
+    int drawn_particles = 0;
+    bool drawn_paused = false;
+    unsigned long long int terminal_version = 0;
     double newLastTime = glfwGetTime();
 
-    const double maxFPS = 60.0;
-    const double maxPeriod = 1.0 / maxFPS;
-    double drop_speed = 1.6;
+    // Without a cap the frame budget for the quality heuristic stays at 60 fps
+    const double maxPeriod = max_fps > 0. ? 1.0 / max_fps : 0.;
+    const double budgetPeriod = max_fps > 0. ? maxPeriod : 1.0 / 60.0;
+    // Frames are due on a fixed grid so sleep overshoot does not accumulate
+    double nextFrame = newLastTime + maxPeriod;
 
-    OglRect *pRects[TOTAL_SQUARE_NUM];
-    for (int col = 0; col < TOTAL_ROWS; ++col) {
-        for (int row = 0; row < TOTAL_COLS; ++row) {
-            pRects[col * TOTAL_ROWS + row] = new OglRect(row, col);
-        }
-    }
+    // The board is set up, from here on only the simulation thread touches it
+    Log::init();
+    sim_running.store(true, std::memory_order_release);
+    std::thread sim_thread(sim_thread_main);
+    double first_frame_start = startup_ms();
 
     // Loop until the user closes the window
     while (!glfwWindowShouldClose(window))
@@ -280,45 +1422,204 @@ int task_4() {
         double newCurrentTime = glfwGetTime();
 
         double deltaTime = newCurrentTime - newLastTime;
-        if (deltaTime >= maxPeriod) {
+        if (newCurrentTime >= nextFrame) {
+            pace_late += newCurrentTime - nextFrame;
+            pace_late_max = std::max(pace_late_max, newCurrentTime - nextFrame);
+            ++pace_frames;
+            nextFrame += maxPeriod;
+            if (nextFrame < newCurrentTime) {
+                nextFrame = newCurrentTime + maxPeriod;
+            }
             newLastTime = newCurrentTime;
+            TRACE_ZONE("frame");
+            double frame_start = glfwGetTime();
             double currentTime = glfwGetTime();
-            nbFrames++;
-            if ( (currentTime - lastTime) >= (1.0 / drop_speed) ){ // If last prinf() was more than 1 sec ago
-                // printf and reset timer
-
-                printf("%f ms/frame\n", 1000.0/double(nbFrames));
-                nbFrames = 0;
-                lastTime += 1.0 / drop_speed;
-                run_game();
-                if (total_smashed % 12 == 0 && drop_speed < 10.0) {
-                    printf("toal smashed: %lld\n", total_smashed);
-                    total_smashed = 1;
-                    drop_speed += 0.1;
-                }
+
+            // Draw the newest tick the simulation has finished
+            snapshots.update();
+            const GameSnapshot& snap = snapshots.read_buffer();
+            drain_particle_bursts();
+            Particles::update((float)deltaTime);
+            float alpha = (float)std::min((currentTime - snap.tick_time) / SIM_TICK, 1.0);
+
+            if (terminal != NULL && terminal_resized) {
+                terminal_resized = 0;
+                terminal->invalidate();
+                terminal_version = snap.version - 1;
             }
-            // Get size of the window
-            int width, height;
-            glfwGetWindowSize(window, &width, &height);
+            if (terminal != NULL && terminal_version != snap.version) {
+                terminal_version = snap.version;
+                TRACE_ZONE("render_terminal");
+                render_terminal(*terminal, snap);
+            }
+
+            // Nothing changed since the last presented frame, keep showing it
+            bool unchanged = present_on_change && snap.version == drawn_version &&
+                             view_version == drawn_view &&
+                             RenderTarget::profile == drawn_profile &&
+                             Particles::alive == 0 && drawn_particles == 0 &&
+                             !(snap.sliding && alpha < 1.f);
+            if (unchanged) {
+                ++frames_skipped;
+            } else {
+                ++frames_presented;
+                drawn_version = snap.version;
+                drawn_view = view_version;
+                drawn_profile = RenderTarget::profile;
+                drawn_paused = sim_paused.load(std::memory_order_relaxed);
+                drawn_particles = Particles::alive;
 
-            // Clear the framebuffer
-            glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT);
+                // Get size of the window
+                int width, height;
+                glfwGetWindowSize(window, &width, &height);
 
-            render_game(pRects);
+                RenderTarget::begin();
+
+                // Clear the framebuffer
+                GpuTimers::begin(GpuTimers::PASS_CLEAR);
+                glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT);
+                GpuTimers::end();
+
+                GpuTimers::begin(GpuTimers::PASS_BOARD);
+                render_game(pRects, snap, alpha);
+                GpuTimers::end();
+
+                GpuTimers::begin(GpuTimers::PASS_PARTICLES);
+                {
+                    TRACE_ZONE("Particles::render");
+                    Particles::render();
+                }
+                GpuTimers::end();
+
+                GpuTimers::begin(GpuTimers::PASS_PRESENT);
+                {
+                    TRACE_ZONE("RenderTarget::present");
+                    RenderTarget::present();
+                }
+                GpuTimers::end();
+
+                hud_stats.score = snap.score;
+                hud_stats.lines = snap.lines;
+                hud_stats.level = snap.level;
+                hud_stats.drop_speed = snap.drop_speed;
+                hud_stats.next_type = snap.next_type;
+                hud_stats.quality = RenderTarget::profiles[RenderTarget::profile].name;
+                hud_stats.quality_auto = RenderTarget::automatic;
+                hud_stats.paused = drawn_paused;
+                if (GpuTimers::supported) {
+                    hud_stats.gpu_clear_ms = GpuTimers::average_ms(GpuTimers::PASS_CLEAR);
+                    hud_stats.gpu_board_ms = GpuTimers::average_ms(GpuTimers::PASS_BOARD);
+                    hud_stats.gpu_particles_ms = GpuTimers::average_ms(GpuTimers::PASS_PARTICLES);
+                    hud_stats.gpu_present_ms = GpuTimers::average_ms(GpuTimers::PASS_PRESENT);
+                    hud_stats.gpu_hud_ms = GpuTimers::average_ms(GpuTimers::PASS_HUD);
+                }
+                if (currentTime - lastHudTiming >= hudTimingPeriod) {
+                    lastHudTiming = currentTime;
+                    hud_timing.copy_timing(hud_stats);
+                }
+                HudStats hud_shown = hud_stats;
+                hud_shown.copy_timing(hud_timing);
+                // Timed inside the query: ending it makes a software renderer
+                // flush, which is the profiler's cost rather than the HUD's
+                GpuTimers::begin(GpuTimers::PASS_HUD);
+                {
+                    TRACE_ZONE("Hud::render");
+                    double hud_start = glfwGetTime();
+                    Hud::render(hud_shown);
+                    hud_stats.hud_ms = 1000.0 * (glfwGetTime() - hud_start);
+                }
+                GpuTimers::end();
+                hud_histogram.record(hud_stats.hud_ms);
 
-            // Swap front and back buffers
-            glfwSwapBuffers(window);
+                // Swap front and back buffers
+                double swap_start = glfwGetTime();
+                {
+                    TRACE_ZONE("glfwSwapBuffers");
+                    glfwSwapBuffers(window);
+                }
+                swap_histogram.record(1000.0 * (glfwGetTime() - swap_start));
+                if (latency_mode != LATENCY_OFF) {
+                    record_input_latency(drawn_version);
+                }
+                GpuTimers::end_frame();
+                if (totalFrames == 0) {
+                    startup_phase("first frame", "main", first_frame_start);
+                    print_startup_timeline();
+                }
+
+                double frame_ms = 1000.0 * (glfwGetTime() - frame_start);
+                frame_ms_history[totalFrames++ % FRAME_HISTORY] = frame_ms;
+                frame_histogram.record(frame_ms);
+                hud_stats.frame_ms = frame_ms;
+                hud_stats.frame_avg_ms = 0.;
+                hud_stats.frame_max_ms = 0.;
+                for (int i = 0; i < FRAME_HISTORY; ++i) {
+                    hud_stats.frame_avg_ms += frame_ms_history[i] / FRAME_HISTORY;
+                    hud_stats.frame_max_ms = std::max(hud_stats.frame_max_ms, frame_ms_history[i]);
+                }
+            }
+            if (currentTime - lastTelemetry >= 1.0) {
+                lastTelemetry = currentTime;
+                print_telemetry(hud_stats, snap);
+                RenderTarget::adapt(hud_stats.frame_avg_ms, 1000.0 * budgetPeriod);
+            }
+#ifdef TETRIS_HEADLESS
+            headless_drive(window, newFrames++);
+#endif
         }
-        if (is_ending) {
+        if (snapshots.read_buffer().ending) {
             break;
         }
-        // Poll for and process events
-        glfwPollEvents();
+        // Sleep until input arrives or the next frame is nearly due
+        double remaining = nextFrame - glfwGetTime();
+        if (sim_paused.load(std::memory_order_relaxed) && drawn_paused) {
+            // The paused frame is on screen, nothing to do until an event
+            TRACE_ZONE("glfwWaitEvents");
+            glfwWaitEvents();
+            newLastTime = glfwGetTime();
+            nextFrame = newLastTime;
+        } else if (remaining > PACER_SPIN) {
+            TRACE_ZONE("glfwWaitEventsTimeout");
+            double sleep_start = glfwGetTime();
+            glfwWaitEventsTimeout(remaining - PACER_SPIN);
+            pace_sleep += glfwGetTime() - sleep_start;
+        } else {
+            // Poll through the last moments as one zone, not one per call
+            TRACE_ZONE("glfwPollEvents");
+            do {
+                glfwPollEvents();
+            } while (glfwGetTime() < nextFrame);
+        }
     }
 
-    glfwTerminate();
+    {
+        std::lock_guard<std::mutex> lock(pause_mutex);
+        sim_running.store(false, std::memory_order_release);
+    }
+    pause_changed.notify_all();
+    sim_thread.join();
+    // The trace and the log are flushed once nothing else writes to them
+    stop_planner();
+    JobSystem::shutdown();
+    TRACE_FLUSH();
+    Log::shutdown();
+
+    const char* stats_path = getenv("TETRIS_STATS");
+    if (stats_path != NULL) {
+        write_histograms(stats_path);
+    }
+
+    if (terminal != NULL) {
+        delete terminal;
+        fclose(terminal_file);
+    }
+    RenderTarget::teardown();
+    GpuTimers::teardown();
+    Particles::teardown();
+    Hud::teardown();
     OglRect::teardown();
+    glfwTerminate();
 
     free_game_memory(pRects);
     exit(0);
@@ -326,8 +1627,13 @@ int task_4() {
 }
 
 
-int main(void) {
+int main(int argc, char *argv[]) {
     int status;
+#ifdef TETRIS_HEADLESS
+    if (argc > 1) {
+        headless_frames = atoll(argv[1]);
+    }
+#endif
     task_4();
 
     return 0;